@@ -0,0 +1,300 @@
+﻿// basic_sudoku.h : Sudoku grids of any box shape, 4x4 and 6x6 up to 16x16 and 25x25, with the unit tables and
+// the candidate mask width fixed at compile time. the tables come from the builder in sudoku_tables.h, the 9x9
+// grid is the tuned sudoku built from the same tables: basic_grid<3, 3> is sudoku and basic_solver<3, 3> its search.
+
+#pragma once
+
+#include "sudoku.h"
+#include "sudoku_tables.h"
+#include "solver_context.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// the narrowest unsigned type with a bit per digit
+template <int Digits>
+using candidate_mask = std::conditional_t<Digits <= 8, std::uint8_t,
+                       std::conditional_t<Digits <= 16, std::uint16_t,
+                       std::conditional_t<Digits <= 32, std::uint32_t, std::uint64_t>>>;
+
+// propagates naked singles as digits are placed and hidden singles on request. digits are 1 to digits,
+// 0 is an empty cell
+template <int BoxRows, int BoxColumns = BoxRows>
+class basic_sudoku {
+public:
+
+    using tables = sudoku_tables::grid_tables<BoxRows, BoxColumns>;
+    using mask = candidate_mask<tables::digits>;
+
+    static constexpr int digits = tables::digits;
+    static constexpr int num_cells = tables::num_cells;
+    static constexpr mask all_digits = static_cast<mask> ((std::uint64_t{ 1 } << digits) - 1);
+
+    static_assert(BoxRows >= 2 && BoxColumns >= 2 && digits <= 35, "digits are written as 1-9 and A-Z");
+
+private:
+
+    std::array<std::uint8_t, num_cells> grid_{};
+    std::array<mask, num_cells> candidates_{};
+    int open_cells_{ num_cells };
+    bool valid_{ true };
+
+public:
+
+    // givens that contradict each other leave the grid !valid()
+    explicit basic_sudoku(const std::array<int, num_cells>& grid) {
+        candidates_.fill(all_digits);
+        for (int idx = 0; idx < num_cells && valid_; ++idx) {
+            if (grid[idx] && grid_[idx] != grid[idx]) {
+                valid_ = place(idx, grid[idx]);
+            }
+        }
+    }
+
+    const std::array<std::uint8_t, num_cells>& grid() const { return grid_; }
+    mask candidates(int idx) const { return candidates_[idx]; }
+    bool valid() const { return valid_; }
+    bool is_solved() const { return valid_ && open_cells_ == 0; }
+
+    // places digit and every naked single it leaves behind, false when a peer runs out of candidates
+    bool place(int idx, int digit) {
+        if (grid_[idx] == digit) {
+            return true;
+        }
+        if (grid_[idx] != 0 || !(candidates_[idx] & mask{ 1 } << (digit - 1))) {
+            return valid_ = false;
+        }
+
+        std::array<typename tables::index, num_cells> queue;
+        int head = 0;
+        int tail = 0;
+
+        const auto assign = [&](int cell, int d) {
+            grid_[cell] = static_cast<std::uint8_t> (d);
+            candidates_[cell] = static_cast<mask> (mask{ 1 } << (d - 1));
+            --open_cells_;
+            queue[tail++] = static_cast<typename tables::index> (cell);
+        };
+
+        assign(idx, digit);
+        while (head < tail) {
+            const int cell = queue[head++];
+            const mask bit = candidates_[cell];
+
+            for (int peer : sudoku_tables::tables_for<BoxRows, BoxColumns>.peers[cell]) {
+                if (!(candidates_[peer] & bit)) {
+                    continue;
+                }
+                if (grid_[peer] != 0) {
+                    return valid_ = false;
+                }
+
+                candidates_[peer] &= static_cast<mask> (~bit);
+                if (candidates_[peer] == 0) {
+                    return valid_ = false;
+                }
+                if (std::has_single_bit(candidates_[peer])) {
+                    assign(peer, std::countr_zero(candidates_[peer]) + 1);
+                }
+            }
+        }
+        return true;
+    }
+
+    // places hidden singles until none are left, false when a digit has no place left in some unit
+    bool propagate() {
+        for (bool changed = valid_; changed;) {
+            changed = false;
+            for (const auto& unit : sudoku_tables::tables_for<BoxRows, BoxColumns>.units) {
+                mask once = 0;
+                mask twice = 0;
+                mask placed = 0;
+                for (int idx : unit) {
+                    if (grid_[idx]) {
+                        placed |= candidates_[idx];
+                    }
+                    else {
+                        twice |= once & candidates_[idx];
+                        once |= candidates_[idx];
+                    }
+                }
+
+                if ((once | placed) != all_digits) {
+                    return valid_ = false;
+                }
+
+                for (mask hidden = once & ~twice & ~placed; hidden; hidden &= hidden - 1) {
+                    const mask bit = hidden & static_cast<mask> (~hidden + 1);
+                    for (int idx : unit) {
+                        if (!grid_[idx] && (candidates_[idx] & bit)) {
+                            if (!place(idx, std::countr_zero(bit) + 1)) {
+                                return false;
+                            }
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        return valid_;
+    }
+
+    // the open cell with the fewest candidates, -1 when every cell is filled
+    int min_cell() const {
+        int best = -1;
+        int best_count = digits + 1;
+        for (int idx = 0; idx < num_cells; ++idx) {
+            if (grid_[idx] == 0) {
+                int count = std::popcount(candidates_[idx]);
+                if (count < best_count) {
+                    best = idx;
+                    best_count = count;
+                    if (count == 2) {
+                        break;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+};
+
+// the grid of a box shape, 3x3 boxes are the tuned sudoku
+template <int BoxRows, int BoxColumns = BoxRows>
+using basic_grid = std::conditional_t<BoxRows == 3 && BoxColumns == 3, sudoku, basic_sudoku<BoxRows, BoxColumns>>;
+
+// depth first search over basic_sudoku, the stack is reused by every puzzle. not thread safe, use one per thread
+template <int BoxRows, int BoxColumns = BoxRows>
+class basic_solver {
+public:
+
+    using grid_type = basic_sudoku<BoxRows, BoxColumns>;
+
+private:
+
+    std::vector<grid_type> stack_;
+
+    template <typename OnSolved>
+    void search(const grid_type& s, OnSolved&& on_solved) {
+        stack_.clear();
+        if (s.valid()) {
+            stack_.push_back(s);
+        }
+
+        while (!stack_.empty()) {
+            if (!stack_.back().propagate()) {
+                stack_.pop_back();
+                continue;
+            }
+            if (stack_.back().is_solved()) {
+                if (!on_solved(stack_.back())) {
+                    return;
+                }
+                stack_.pop_back();
+                continue;
+            }
+
+            //replace the state with a branch per candidate of its most constrained cell
+            const grid_type before = stack_.back();
+            stack_.pop_back();
+
+            const int idx = before.min_cell();
+            for (auto bits = before.candidates(idx); bits; bits &= bits - 1) {
+                stack_.push_back(before);
+                if (!stack_.back().place(idx, std::countr_zero(bits) + 1)) {
+                    stack_.pop_back();
+                }
+            }
+        }
+    }
+
+public:
+
+    basic_solver() { stack_.reserve(grid_type::num_cells); }
+
+    // returns s when there is no solution
+    grid_type solve(const grid_type& s) {
+        grid_type solution = s;
+        search(s, [&](const grid_type& solved) {
+            solution = solved;
+            return false;
+        });
+        return solution;
+    }
+
+    // number of solutions of s, the search stops once limit are found
+    int count_solutions(const grid_type& s, int limit = 2) {
+        int count = 0;
+        search(s, [&](const grid_type&) {
+            return ++count < limit;
+        });
+        return count;
+    }
+};
+
+// 9x9 grids are searched like every other puzzle, see solver_context
+template <>
+class basic_solver<3, 3> {
+
+    solver_context context_;
+
+public:
+
+    using grid_type = sudoku;
+
+    grid_type solve(const grid_type& s) { return context_.solve(s); }
+    int count_solutions(const grid_type& s, int limit = 2) { return context_.count_solutions(s, limit); }
+};
+
+// digits are written 1-9 and then A-Z, '.' or '0' is an empty cell
+inline char digit_symbol(int digit) {
+    return digit == 0 ? '.' : digit < 10 ? static_cast<char> ('0' + digit) : static_cast<char> ('A' + digit - 10);
+}
+
+// exactly BoxRows * BoxColumns squared symbols, throws parse_error for anything else. 9x9 grids are read by
+// parse_sudoku
+template <int BoxRows, int BoxColumns = BoxRows>
+basic_grid<BoxRows, BoxColumns> parse_basic_sudoku(std::string_view line) {
+    if constexpr (BoxRows == 3 && BoxColumns == 3) {
+        return parse_sudoku(line);
+    }
+    else {
+        using grid_type = basic_sudoku<BoxRows, BoxColumns>;
+
+        if (line.size() != grid_type::num_cells) {
+            throw parse_error("expected " + std::to_string(grid_type::num_cells) + " cells, got " + std::to_string(line.size()),
+                              std::min(line.size(), static_cast<std::size_t> (grid_type::num_cells)));
+        }
+
+        std::array<int, grid_type::num_cells> digits{};
+        for (std::size_t i = 0; i < line.size(); ++i) {
+            const char c = line[i];
+            int digit = c == '.' || c == '0' ? 0
+                : c >= '1' && c <= '9' ? c - '0'
+                : c >= 'A' && c <= 'Z' ? c - 'A' + 10
+                : c >= 'a' && c <= 'z' ? c - 'a' + 10
+                : -1;
+            if (digit < 0 || digit > grid_type::digits) {
+                throw parse_error(std::string("unexpected character '") + c + "' at column " + std::to_string(i + 1), i);
+            }
+            digits[i] = digit;
+        }
+        return grid_type{ digits };
+    }
+}
+
+template <int BoxRows, int BoxColumns>
+std::string to_string(const basic_sudoku<BoxRows, BoxColumns>& s) {
+    std::string line(s.grid().size(), '.');
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        line[i] = digit_symbol(s.grid()[i]);
+    }
+    return line;
+}
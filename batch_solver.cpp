@@ -0,0 +1,260 @@
+﻿// batch_solver.cpp : Solves many independent puzzles across a task_pool.
+//
+
+#include "batch_solver.h"
+#include "solver_engine.h"
+#include "lockstep_solver.h"
+#include "puzzle_format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <span>
+
+namespace {
+
+    using double_s = std::chrono::duration<double>;
+
+    std::vector<std::unique_ptr<solver_engine>> make_engines(const task_pool& pool, std::string_view engine, branch_policy policy) {
+        std::vector<std::unique_ptr<solver_engine>> engines;
+        for (unsigned i = 0; i < pool.size(); ++i) {
+            engines.push_back(make_engine(engine, policy));
+        }
+        return engines;
+    }
+
+    // solutions must already hold puzzles.size() grids, stats is either empty or as long. returns the number solved
+    int solve_range(std::span<const sudoku> puzzles, std::span<sudoku> solutions, std::span<solve_stats> stats, task_pool& pool,
+                    std::vector<std::unique_ptr<solver_engine>>& engines, bool lockstep) {
+        std::atomic<int> num_solved{ 0 };
+
+        if (lockstep) {
+            const int num_groups = (static_cast<int> (puzzles.size()) + lockstep_lanes - 1) / lockstep_lanes;
+
+            pool.parallel_for(0, num_groups, 1, [&](int begin, int end) {
+                auto& worker_engine = *engines[task_pool::worker_index()];
+                std::size_t first = static_cast<std::size_t> (begin) * lockstep_lanes;
+                std::size_t count = std::min(static_cast<std::size_t> (end - begin) * lockstep_lanes, puzzles.size() - first);
+                auto group_stats = stats.empty() ? stats : stats.subspan(first, count);
+                num_solved += solve_lockstep(puzzles.subspan(first, count), solutions.subspan(first, count), worker_engine, group_stats);
+            });
+        }
+        else {
+            // small ranges keep the pool balanced when a few evil grids land next to each other
+            constexpr int grain = 16;
+
+            pool.parallel_for(0, static_cast<int> (puzzles.size()), grain, [&](int begin, int end) {
+                auto& worker_engine = *engines[task_pool::worker_index()];
+                int solved = 0;
+                for (int i = begin; i < end; ++i) {
+                    solutions[i] = worker_engine.solve(puzzles[i]);
+                    solved += solutions[i].is_solved();
+                    if (!stats.empty()) {
+                        stats[i] = worker_engine.stats();
+                    }
+                }
+                num_solved += solved;
+            });
+        }
+
+        return num_solved;
+    }
+
+    // enough groups per chunk to keep every worker busy while the buffers stay a few hundred kilobytes
+    constexpr std::size_t chunk_size = 4 * puzzle_format::index_stride;
+
+    using chunk_source = std::function<std::size_t(std::vector<sudoku>&)>;
+
+    // solves chunk after chunk until next_chunk(puzzles) fills no more puzzles. the buffers are reused for every chunk
+    stream_result solve_chunks(task_pool& pool, std::string_view engine, bool lockstep, branch_policy policy, const chunk_source& next_chunk,
+                               const std::function<void(std::span<const sudoku>)>& emit) {
+        stream_result result;
+        auto engines = make_engines(pool, engine, policy);
+
+        std::vector<sudoku> puzzles(chunk_size, sudoku{ {} });
+        std::vector<sudoku> solutions(chunk_size, sudoku{ {} });
+        std::vector<solve_stats> stats(stats::enabled ? chunk_size : 0);
+
+        auto solver_start = std::chrono::steady_clock::now();
+        for (std::size_t count = next_chunk(puzzles); count > 0; count = next_chunk(puzzles)) {
+            std::span<const sudoku> chunk_puzzles{ puzzles.data(), count };
+            std::span<sudoku> chunk_solutions{ solutions.data(), count };
+            std::span<solve_stats> chunk_stats{ stats.data(), stats.empty() ? 0 : count };
+            result.num_solved += solve_range(chunk_puzzles, chunk_solutions, chunk_stats, pool, engines, lockstep);
+            for (const auto& s : chunk_stats) {
+                result.total_stats += s;
+            }
+            result.num_puzzles += static_cast<int> (count);
+
+            emit(chunk_solutions);
+        }
+        auto solver_end = std::chrono::steady_clock::now();
+
+        result.seconds = std::chrono::duration_cast<double_s> (solver_end - solver_start).count();
+        return result;
+    }
+
+    // parses the next chunk of puzzle lines of text into puzzles
+    chunk_source text_chunks(std::string_view text, task_pool& pool) {
+        //lines point straight into text
+        std::vector<std::string_view> lines;
+        lines.reserve(chunk_size);
+
+        return [text, &pool, lines = std::move(lines), pos = std::size_t{ 0 }](std::vector<sudoku>& puzzles) mutable {
+            lines.clear();
+            for (auto line = puzzle_format::next_puzzle_line(text, pos); !line.empty(); line = puzzle_format::next_puzzle_line(text, pos)) {
+                lines.push_back(line);
+                if (lines.size() == chunk_size) {
+                    break;
+                }
+            }
+
+            //the earliest bad line is reported, whichever task finds it
+            std::atomic<std::size_t> first_bad{ lines.size() };
+            pool.parallel_for(0, static_cast<int> (lines.size()), 256, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    try {
+                        puzzles[i] = parse_sudoku(lines[i]);
+                    }
+                    catch (const parse_error&) {
+                        std::size_t bad = first_bad;
+                        while (static_cast<std::size_t> (i) < bad && !first_bad.compare_exchange_weak(bad, i)) {}
+                        break;
+                    }
+                }
+            });
+
+            if (first_bad < lines.size()) {
+                try {
+                    parse_sudoku(lines[first_bad]);
+                }
+                catch (const parse_error& e) {
+                    throw puzzle_format::locate(text, lines[first_bad], e);
+                }
+            }
+            return lines.size();
+        };
+    }
+
+    // decodes the next chunk of records of reader into puzzles
+    chunk_source binary_chunks(const puzzle_reader& reader, task_pool& pool) {
+        return [&reader, &pool, first = std::size_t{ 0 }](std::vector<sudoku>& puzzles) mutable {
+            constexpr int stride = static_cast<int> (puzzle_format::index_stride);
+            std::size_t count = std::min(chunk_size, reader.size() - first);
+
+            //every indexed stride decodes on its own, a damaged record is reported once the chunk is done
+            std::mutex error_mutex;
+            std::exception_ptr error;
+            pool.parallel_for(0, static_cast<int> (count), stride, [&](int begin, int end) {
+                try {
+                    reader.read(first + begin, std::span<sudoku>{ puzzles.data() + begin, static_cast<std::size_t> (end - begin) });
+                }
+                catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    error = std::current_exception();
+                }
+            });
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            first += count;
+            return count;
+        };
+    }
+
+    // copies the next chunk of all into puzzles
+    chunk_source vector_chunks(const std::vector<sudoku>& all) {
+        return [&all, first = std::size_t{ 0 }](std::vector<sudoku>& puzzles) mutable {
+            std::size_t count = std::min(chunk_size, all.size() - first);
+            std::copy_n(all.begin() + first, count, puzzles.begin());
+            first += count;
+            return count;
+        };
+    }
+
+    // counts the solutions of chunk after chunk, see solve_chunks
+    count_result count_chunks(task_pool& pool, std::string_view engine, branch_policy policy, int limit, const chunk_source& next_chunk,
+                              const std::function<void(std::span<const int>)>& emit) {
+        count_result result;
+        auto engines = make_engines(pool, engine, policy);
+
+        std::vector<sudoku> puzzles(chunk_size, sudoku{ {} });
+        std::vector<int> counts(chunk_size);
+        std::vector<solve_stats> stats(stats::enabled ? chunk_size : 0);
+
+        auto solver_start = std::chrono::steady_clock::now();
+        for (std::size_t count = next_chunk(puzzles); count > 0; count = next_chunk(puzzles)) {
+            constexpr int grain = 16;
+
+            pool.parallel_for(0, static_cast<int> (count), grain, [&](int begin, int end) {
+                auto& worker_engine = *engines[task_pool::worker_index()];
+                for (int i = begin; i < end; ++i) {
+                    counts[i] = worker_engine.count_solutions(puzzles[i], limit);
+                    if (!stats.empty()) {
+                        stats[i] = worker_engine.stats();
+                    }
+                }
+            });
+
+            std::span<const int> chunk_counts{ counts.data(), count };
+            for (int c : chunk_counts) {
+                result.num_unique += c == 1;
+                result.num_unsolvable += c == 0;
+            }
+            for (const auto& s : std::span{ stats.data(), stats.empty() ? 0 : count }) {
+                result.total_stats += s;
+            }
+            result.num_puzzles += static_cast<int> (count);
+
+            emit(chunk_counts);
+        }
+        auto solver_end = std::chrono::steady_clock::now();
+
+        result.seconds = std::chrono::duration_cast<double_s> (solver_end - solver_start).count();
+        return result;
+    }
+}
+
+batch_result solve_batch(const std::vector<sudoku>& puzzles, task_pool& pool, std::string_view engine, bool lockstep,
+                         branch_policy policy) {
+    batch_result result{ puzzles, 0, 0.0, std::vector<solve_stats>(stats::enabled ? puzzles.size() : 0), solve_stats{} };
+    auto engines = make_engines(pool, engine, policy);
+
+    auto solver_start = std::chrono::steady_clock::now();
+    result.num_solved = solve_range(puzzles, result.solutions, result.stats, pool, engines, lockstep);
+    auto solver_end = std::chrono::steady_clock::now();
+
+    for (const auto& s : result.stats) {
+        result.total_stats += s;
+    }
+
+    result.seconds = std::chrono::duration_cast<double_s> (solver_end - solver_start).count();
+    return result;
+}
+
+stream_result solve_text(std::string_view text, task_pool& pool, const std::function<void(std::span<const sudoku>)>& emit,
+                         std::string_view engine, bool lockstep, branch_policy policy) {
+    return solve_chunks(pool, engine, lockstep, policy, text_chunks(text, pool), emit);
+}
+
+stream_result solve_binary(const puzzle_reader& reader, task_pool& pool, const std::function<void(std::span<const sudoku>)>& emit,
+                           std::string_view engine, bool lockstep, branch_policy policy) {
+    return solve_chunks(pool, engine, lockstep, policy, binary_chunks(reader, pool), emit);
+}
+
+count_result count_text(std::string_view text, task_pool& pool, const std::function<void(std::span<const int>)>& emit, int limit,
+                        std::string_view engine, branch_policy policy) {
+    return count_chunks(pool, engine, policy, limit, text_chunks(text, pool), emit);
+}
+
+count_result count_binary(const puzzle_reader& reader, task_pool& pool, const std::function<void(std::span<const int>)>& emit,
+                          int limit, std::string_view engine, branch_policy policy) {
+    return count_chunks(pool, engine, policy, limit, binary_chunks(reader, pool), emit);
+}
+
+count_result count_batch(const std::vector<sudoku>& puzzles, task_pool& pool, const std::function<void(std::span<const int>)>& emit,
+                         int limit, std::string_view engine, branch_policy policy) {
+    return count_chunks(pool, engine, policy, limit, vector_chunks(puzzles), emit);
+}
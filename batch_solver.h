@@ -0,0 +1,70 @@
+﻿// batch_solver.h : Solves many independent puzzles across a task_pool.
+
+#pragma once
+
+#include "sudoku.h"
+#include "task_pool.h"
+#include "puzzle_format.h"
+#include "solve_stats.h"
+
+#include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct batch_result {
+    std::vector<sudoku> solutions;  //in the same order as the puzzles
+    int num_solved{ 0 };
+    double seconds{ 0.0 };
+    std::vector<solve_stats> stats; //per puzzle when built with SUDOKU_STATS, empty otherwise
+    solve_stats total_stats;
+
+    double puzzles_per_second() const { return seconds > 0.0 ? solutions.size() / seconds : 0.0; }
+};
+
+struct stream_result {
+    int num_puzzles{ 0 };
+    int num_solved{ 0 };
+    double seconds{ 0.0 };
+    solve_stats total_stats;        //all zero unless built with SUDOKU_STATS
+
+    double puzzles_per_second() const { return seconds > 0.0 ? num_puzzles / seconds : 0.0; }
+};
+
+struct count_result {
+    int num_puzzles{ 0 };
+    int num_unique{ 0 };            //exactly one solution
+    int num_unsolvable{ 0 };
+    double seconds{ 0.0 };
+    solve_stats total_stats;        //all zero unless built with SUDOKU_STATS
+
+    double puzzles_per_second() const { return seconds > 0.0 ? num_puzzles / seconds : 0.0; }
+};
+
+// each worker gets its own engine of the named kind steered by policy, see make_engine. with lockstep the singles are
+// first propagated for groups of puzzles together, see solve_lockstep, and only the rest reaches the engine
+batch_result solve_batch(const std::vector<sudoku>& puzzles, task_pool& pool, std::string_view engine = "rules", bool lockstep = true,
+                         branch_policy policy = branch_policy::mrv);
+
+// solves the puzzle lines of text in chunks, parsing them in place, so memory stays flat however long
+// the text is and the first solutions are ready right away. text is usually a mapped_file.
+// empty lines and lines starting with '#' are skipped. emit receives the solutions of each chunk in input order
+stream_result solve_text(std::string_view text, task_pool& pool, const std::function<void(std::span<const sudoku>)>& emit,
+                         std::string_view engine = "rules", bool lockstep = true, branch_policy policy = branch_policy::mrv);
+
+// the same for a binary puzzle file, each indexed stride of records is decoded by its own task
+stream_result solve_binary(const puzzle_reader& reader, task_pool& pool, const std::function<void(std::span<const sudoku>)>& emit,
+                           std::string_view engine = "rules", bool lockstep = true, branch_policy policy = branch_policy::mrv);
+
+// counts the solutions of every puzzle line of text up to limit, chunk by chunk like solve_text.
+// emit receives the counts of each chunk in input order, a count equal to limit means limit or more
+count_result count_text(std::string_view text, task_pool& pool, const std::function<void(std::span<const int>)>& emit, int limit = 2,
+                        std::string_view engine = "rules", branch_policy policy = branch_policy::mrv);
+
+// the same for a binary puzzle file
+count_result count_binary(const puzzle_reader& reader, task_pool& pool, const std::function<void(std::span<const int>)>& emit,
+                          int limit = 2, std::string_view engine = "rules", branch_policy policy = branch_policy::mrv);
+
+// the same for puzzles already in memory
+count_result count_batch(const std::vector<sudoku>& puzzles, task_pool& pool, const std::function<void(std::span<const int>)>& emit,
+                         int limit = 2, std::string_view engine = "rules", branch_policy policy = branch_policy::mrv);
@@ -0,0 +1,205 @@
+﻿// dlx_engine.cpp : Dancing links (Algorithm X) exact cover backend.
+//
+
+#include "dlx_engine.h"
+#include "variant_sudoku.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // the four columns covered by placing digit d (0-8) in cell idx
+    constexpr std::array<int, 4> row_columns(int idx, int d) {
+        int r = idx / 9;
+        int c = idx % 9;
+        int b = 3 * (r / 3) + c / 3;
+        return { 1 + idx, 1 + 81 + 9 * r + d, 1 + 162 + 9 * c + d, 1 + 243 + 9 * b + d };
+    }
+}
+
+void dlx_engine::link() {
+    for (int c = 0; c <= num_columns; ++c) {
+        left_[c] = c == 0 ? num_columns : c - 1;
+        right_[c] = c == num_columns ? 0 : c + 1;
+        up_[c] = c;
+        down_[c] = c;
+        column_[c] = c;
+        size_[c] = 0;
+    }
+
+    int node = num_columns + 1;
+    for (int r = 0; r < num_rows; ++r) {
+        auto columns = row_columns(r / 9, r % 9);
+        int first = node;
+
+        for (int k = 0; k < 4; ++k, ++node) {
+            int c = columns[k];
+
+            //append at the bottom of the column
+            up_[node] = up_[c];
+            down_[node] = c;
+            down_[up_[c]] = node;
+            up_[c] = node;
+            ++size_[c];
+
+            left_[node] = k == 0 ? first + 3 : node - 1;
+            right_[node] = k == 3 ? first : node + 1;
+            column_[node] = c;
+            row_[node] = r;
+        }
+    }
+}
+
+void dlx_engine::cover(int c) {
+    right_[left_[c]] = right_[c];
+    left_[right_[c]] = left_[c];
+
+    for (int i = down_[c]; i != c; i = down_[i]) {
+        for (int j = right_[i]; j != i; j = right_[j]) {
+            up_[down_[j]] = up_[j];
+            down_[up_[j]] = down_[j];
+            --size_[column_[j]];
+        }
+    }
+}
+
+void dlx_engine::uncover(int c) {
+    for (int i = up_[c]; i != c; i = up_[i]) {
+        for (int j = left_[i]; j != i; j = left_[j]) {
+            ++size_[column_[j]];
+            up_[down_[j]] = j;
+            down_[up_[j]] = j;
+        }
+    }
+
+    right_[left_[c]] = c;
+    left_[right_[c]] = c;
+}
+
+bool dlx_engine::select(int r) {
+    //a given takes its row out of the matrix, it fails when another given already claimed a column
+    int first = num_columns + 1 + 4 * r;
+    for (int k = 0; k < 4; ++k) {
+        int c = column_[first + k];
+        if (left_[right_[c]] != c) {
+            return false;
+        }
+        cover(c);
+    }
+    return true;
+}
+
+bool dlx_engine::search(int depth) {
+    if (right_[root] == root) {
+        solution_size_ = depth;
+        return true;
+    }
+
+    //smallest column first
+    int c = right_[root];
+    for (int j = right_[c]; j != root; j = right_[j]) {
+        if (size_[j] < size_[c]) {
+            c = j;
+        }
+    }
+    if (size_[c] == 0) {
+        return false;
+    }
+
+    cover(c);
+    stats::depth(depth + 1);
+    for (int r = down_[c]; r != c; r = down_[r]) {
+        stats::add(&solve_stats::branches);
+        solution_[depth] = row_[r];
+        for (int j = right_[r]; j != r; j = right_[j]) {
+            cover(column_[j]);
+        }
+
+        if (search(depth + 1)) {
+            return true;
+        }
+
+        stats::add(&solve_stats::backtracks);
+        for (int j = left_[r]; j != r; j = left_[j]) {
+            uncover(column_[j]);
+        }
+    }
+    uncover(c);
+
+    return false;
+}
+
+int dlx_engine::count(int depth, int limit) {
+    if (right_[root] == root) {
+        return 1;
+    }
+
+    int c = right_[root];
+    for (int j = right_[c]; j != root; j = right_[j]) {
+        if (size_[j] < size_[c]) {
+            c = j;
+        }
+    }
+    if (size_[c] == 0) {
+        return 0;
+    }
+
+    int found = 0;
+    cover(c);
+    stats::depth(depth + 1);
+    for (int r = down_[c]; r != c && found < limit; r = down_[r]) {
+        stats::add(&solve_stats::branches);
+        for (int j = right_[r]; j != r; j = right_[j]) {
+            cover(column_[j]);
+        }
+
+        found += count(depth + 1, limit - found);
+
+        stats::add(&solve_stats::backtracks);
+        for (int j = left_[r]; j != r; j = left_[j]) {
+            uncover(column_[j]);
+        }
+    }
+    uncover(c);
+
+    return found;
+}
+
+bool dlx_engine::link_givens(const sudoku& s) {
+    if (!s.tables().classic()) {
+        throw std::invalid_argument("the dlx engine only covers rows, columns and boxes");
+    }
+    link();
+
+    for (int i = 0; i < 81; ++i) {
+        if (int digit = s.grid()[i]; digit && !select(9 * i + digit - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+sudoku dlx_engine::solve(const sudoku& s) {
+    stats_ = {};
+    stats::scope collect(stats_);
+
+    if (!link_givens(s) || !search(0)) {
+        return s;
+    }
+
+    //the matrix is left partly covered, link() restores it for the next puzzle
+    std::array<int, 81> grid{};
+    std::copy(s.grid().begin(), s.grid().end(), grid.begin());
+    for (int i = 0; i < solution_size_; ++i) {
+        grid[solution_[i] / 9] = solution_[i] % 9 + 1;
+    }
+
+    return sudoku{ grid };
+}
+
+int dlx_engine::count_solutions(const sudoku& s, int limit) {
+    stats_ = {};
+    stats::scope collect(stats_);
+
+    return link_givens(s) ? count(0, limit) : 0;
+}
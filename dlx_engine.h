@@ -0,0 +1,48 @@
+﻿// dlx_engine.h : Dancing links (Algorithm X) exact cover backend.
+
+#pragma once
+
+#include "solver_engine.h"
+
+#include <array>
+
+// every (cell, digit) choice is a row covering four columns: the cell, and the digit in its row,
+// column and box. the node storage is fixed size and relinked for every puzzle. puzzles with variant
+// rules throw std::invalid_argument
+class dlx_engine : public solver_engine {
+
+    static constexpr int num_columns = 4 * 81;
+    static constexpr int num_rows = 9 * 81;
+    static constexpr int root = 0;                            //column headers are 1..num_columns
+    static constexpr int num_nodes = 1 + num_columns + 4 * num_rows;
+
+    std::array<int, num_nodes> left_{};
+    std::array<int, num_nodes> right_{};
+    std::array<int, num_nodes> up_{};
+    std::array<int, num_nodes> down_{};
+    std::array<int, num_nodes> column_{};
+    std::array<int, num_nodes> row_{};
+    std::array<int, num_columns + 1> size_{};
+
+    std::array<int, 81> solution_{};  //rows chosen by the search, after the givens
+    int solution_size_{ 0 };
+
+    solve_stats stats_;
+
+private:
+
+    void link();
+    void cover(int c);
+    void uncover(int c);
+    bool select(int r);
+    bool search(int depth);
+    int count(int depth, int limit);
+    bool link_givens(const sudoku& s);
+
+public:
+
+    std::string_view name() const override { return "dlx"; }
+    sudoku solve(const sudoku& s) override;
+    int count_solutions(const sudoku& s, int limit) override;
+    const solve_stats& stats() const override { return stats_; }
+};
@@ -0,0 +1,157 @@
+﻿// lockstep_solver.cpp : Runs singles propagation for groups of puzzles at once in a structure-of-arrays layout.
+//
+
+#include "lockstep_solver.h"
+#include "sudoku_tables.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+    using lanes = std::array<std::uint16_t, lockstep_lanes>;
+
+    // candidates of one cell across the group, a placed digit is a single candidate
+    struct lane_grid {
+        alignas(32) std::array<lanes, 81> cells;
+        alignas(32) lanes dead;     //nonzero once a lane reached a contradiction
+    };
+
+    constexpr std::uint16_t all_digits = 0x1ff;
+
+    //rows, columns and boxes
+    constexpr const auto& all_units = sudoku_tables::classic.units;
+
+    // all ones when the condition holds, masks keep the lane loops free of branches
+    constexpr std::uint16_t when(bool condition) {
+        return static_cast<std::uint16_t> (-static_cast<int> (condition));
+    }
+
+    // every inner loop runs over the lanes with a fixed trip count so it compiles to whole-register operations
+    [[gnu::always_inline]] inline bool propagate_units(lane_grid& g) {
+        alignas(32) lanes changed{};
+
+        for (const auto& unit : all_units) {
+            alignas(32) lanes fixed{}, once{}, twice{}, duplicate{};
+
+            for (int idx : unit) {
+                const lanes& cell = g.cells[idx];
+                for (int l = 0; l < lockstep_lanes; ++l) {
+                    std::uint16_t m = cell[l];
+                    std::uint16_t single = m & when((m & (m - 1)) == 0);
+                    duplicate[l] |= fixed[l] & single;
+                    fixed[l] |= single;
+                    twice[l] |= once[l] & m;
+                    once[l] |= m;
+                }
+            }
+
+            for (int idx : unit) {
+                lanes& cell = g.cells[idx];
+                for (int l = 0; l < lockstep_lanes; ++l) {
+                    std::uint16_t m = cell[l];
+                    //naked singles leave their peers, then a digit with one place left in the unit takes its cell
+                    std::uint16_t n = m & ~(fixed[l] & ~when((m & (m - 1)) == 0));
+                    std::uint16_t hidden = n & once[l] & ~twice[l];
+                    std::uint16_t take = when(hidden != 0);
+                    n = (hidden & take) | (n & ~take);
+                    changed[l] |= n ^ m;
+                    g.dead[l] |= when(n == 0) | duplicate[l];
+                    cell[l] = n;
+                }
+            }
+
+            for (int l = 0; l < lockstep_lanes; ++l) {
+                g.dead[l] |= when(once[l] != all_digits);
+            }
+        }
+
+        std::uint16_t any = 0;
+        for (int l = 0; l < lockstep_lanes; ++l) {
+            any |= changed[l];
+        }
+        return any != 0;
+    }
+
+    // masks only ever shrink, so this reaches a fixpoint
+    void propagate_scalar(lane_grid& g) {
+        while (propagate_units(g)) {}
+    }
+
+    SUDOKU_TARGET_AVX2 void propagate_avx2(lane_grid& g) {
+        while (propagate_units(g)) {}
+    }
+
+    void propagate(lane_grid& g) {
+        if (kernels::active_isa() == "avx2") {
+            propagate_avx2(g);
+        }
+        else {
+            propagate_scalar(g);
+        }
+    }
+
+    int solve_group(std::span<const sudoku> puzzles, std::span<sudoku> solutions, solver_engine& engine, std::span<solve_stats> stats) {
+        lane_grid g{};
+        for (int i = 0; i < 81; ++i) {
+            //unused lanes stay fully open and never change
+            g.cells[i].fill(all_digits);
+            for (std::size_t l = 0; l < puzzles.size(); ++l) {
+                int digit = puzzles[l].grid()[i];
+                if (digit) {
+                    g.cells[i][l] = static_cast<std::uint16_t> (1 << (digit - 1));
+                }
+            }
+        }
+
+        propagate(g);
+
+        int solved = 0;
+        for (std::size_t l = 0; l < puzzles.size(); ++l) {
+            if (g.dead[l]) {
+                solutions[l] = engine.solve(puzzles[l]);
+                solved += solutions[l].is_solved();
+                if (!stats.empty()) {
+                    stats[l] = engine.stats();
+                }
+                continue;
+            }
+
+            std::array<int, 81> grid{};
+            bool complete = true;
+            for (int i = 0; i < 81; ++i) {
+                std::uint16_t m = g.cells[i][l];
+                if (std::has_single_bit(m)) {
+                    grid[i] = std::countr_zero(m) + 1;
+                }
+                else {
+                    complete = false;
+                }
+            }
+
+            //the engine hands back its input when it finds no solution, that has to be the puzzle and not the
+            //propagated grid, so the result is the same as without the lockstep pass. the lanes only propagate
+            //rows, columns and boxes, the rules of the puzzle still have to hold
+            const sudoku propagated(grid, puzzles[l].tables());
+            auto solution = complete ? propagated : engine.solve(propagated);
+            solutions[l] = solution.is_solved() ? solution : puzzles[l];
+            solved += solutions[l].is_solved();
+            if (!stats.empty()) {
+                stats[l] = complete ? solve_stats{} : engine.stats();
+            }
+        }
+        return solved;
+    }
+}
+
+int solve_lockstep(std::span<const sudoku> puzzles, std::span<sudoku> solutions, solver_engine& engine, std::span<solve_stats> stats) {
+    int solved = 0;
+    for (std::size_t begin = 0; begin < puzzles.size(); begin += lockstep_lanes) {
+        std::size_t count = std::min<std::size_t> (lockstep_lanes, puzzles.size() - begin);
+        auto group_stats = stats.empty() ? stats : stats.subspan(begin, count);
+        solved += solve_group(puzzles.subspan(begin, count), solutions.subspan(begin, count), engine, group_stats);
+    }
+    return solved;
+}
@@ -0,0 +1,18 @@
+﻿// lockstep_solver.h : Runs singles propagation for groups of puzzles at once in a structure-of-arrays layout.
+
+#pragma once
+
+#include "sudoku.h"
+#include "solver_engine.h"
+
+#include <span>
+
+// puzzles per group, one 16 bit lane each so a group fills an AVX2 register
+inline constexpr int lockstep_lanes = 16;
+
+// solves puzzles into solutions (same size), propagating naked and hidden singles for whole groups
+// in lockstep. puzzles that still need branching continue from their propagated grid in engine.
+// returns the number of puzzles solved. stats, when not empty, receives the engine's counters per puzzle
+// (zero for the puzzles the lockstep pass finished)
+int solve_lockstep(std::span<const sudoku> puzzles, std::span<sudoku> solutions, solver_engine& engine,
+                   std::span<solve_stats> stats = {});
@@ -0,0 +1,102 @@
+﻿// mapped_file.cpp : Read-only memory mapping of a whole file, so puzzles can be parsed where they lie.
+//
+
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+mapped_file::mapped_file(const std::string& path) {
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        throw std::runtime_error("could not open " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        close();
+        throw std::runtime_error("could not read the size of " + path);
+    }
+    size_ = static_cast<std::size_t> (size.QuadPart);
+
+    //a zero length mapping is an error on windows, an empty file simply has no text
+    if (size_ == 0) {
+        return;
+    }
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_) {
+        data_ = static_cast<const char*> (MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!data_) {
+        close();
+        throw std::runtime_error("could not map " + path);
+    }
+}
+
+void mapped_file::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    struct stat info;
+    if (::fstat(fd_, &info) != 0) {
+        close();
+        throw std::runtime_error("could not read the size of " + path);
+    }
+    size_ = static_cast<std::size_t> (info.st_size);
+
+    if (size_ == 0) {
+        return;
+    }
+
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (data == MAP_FAILED) {
+        close();
+        throw std::runtime_error("could not map " + path);
+    }
+    data_ = static_cast<const char*> (data);
+
+    //the file is read front to back once, let the kernel read ahead and drop pages behind us
+    ::madvise(data, size_, MADV_SEQUENTIAL);
+}
+
+void mapped_file::close() {
+    if (data_) ::munmap(const_cast<char*> (data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+}
+
+#endif
+
+mapped_file::~mapped_file() {
+    close();
+}
@@ -0,0 +1,34 @@
+﻿// mapped_file.h : Read-only memory mapping of a whole file, so puzzles can be parsed where they lie.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+class mapped_file {
+
+    const char* data_{ nullptr };
+    std::size_t size_{ 0 };
+#if defined(_WIN32)
+    void* file_{ nullptr };
+    void* mapping_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+
+private:
+
+    void close();
+
+public:
+
+    // throws std::runtime_error when the file cannot be opened or mapped
+    explicit mapped_file(const std::string& path);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    // valid for the lifetime of the mapping, empty for an empty file
+    std::string_view text() const { return { data_, size_ }; }
+};
@@ -0,0 +1,99 @@
+﻿// parallel_search.cpp : Explores the sibling branches of a single puzzle concurrently.
+//
+
+#include "parallel_search.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    struct search_state {
+        task_pool& pool;
+        int split_depth;
+
+        std::atomic<bool> solved{ false };
+        std::optional<sudoku> solution;
+        std::mutex solution_mutex;
+
+        std::atomic<int> outstanding{ 0 };
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+
+        search_state(task_pool& pool, int split_depth) : pool(pool), split_depth(split_depth) {}
+    };
+
+    void search(search_state& state, sudoku root, int root_depth);
+
+    void spawn(search_state& state, sudoku s, int depth) {
+        ++state.outstanding;
+        state.pool.submit([&state, s = std::move(s), depth]() {
+            search(state, s, depth);
+
+            //decrement under the lock so the waiter cannot return while this task still touches state
+            std::lock_guard lock(state.done_mutex);
+            if (--state.outstanding == 0) {
+                state.done_cv.notify_all();
+            }
+        });
+    }
+
+    void search(search_state& state, sudoku root, int root_depth) {
+        std::vector<std::pair<sudoku, int>> sudoku_search_stack;
+        sudoku_search_stack.reserve(16);
+        sudoku_search_stack.emplace_back(std::move(root), root_depth);
+
+        while (!sudoku_search_stack.empty() && !state.solved.load(std::memory_order_relaxed)) {
+            auto [s, depth] = std::move(sudoku_search_stack.back());
+            sudoku_search_stack.pop_back();
+
+            //propagate until stuck
+            if (s.advance() == step_result::contradiction) {
+                continue;
+            }
+
+            if (s.is_solved()) {
+                std::lock_guard lock(state.solution_mutex);
+                if (!state.solved) {
+                    state.solution = s;
+                    state.solved = true;
+                }
+                return;
+            }
+
+            auto branches = branch_minimal(s);
+            if (branches.empty()) {
+                continue;
+            }
+
+            //keep the last branch for this task, the siblings may run elsewhere
+            if (depth < state.split_depth) {
+                for (std::size_t b = 0; b + 1 < branches.size(); ++b) {
+                    spawn(state, std::move(branches[b]), depth + 1);
+                }
+                sudoku_search_stack.emplace_back(std::move(branches.back()), depth + 1);
+            }
+            else {
+                for (auto& b : branches) {
+                    sudoku_search_stack.emplace_back(std::move(b), depth + 1);
+                }
+            }
+        }
+    }
+}
+
+sudoku solve(const sudoku& s, task_pool& pool, int split_depth) {
+    search_state state(pool, split_depth);
+
+    spawn(state, s, 0);
+
+    //every task has to finish before state goes out of scope, cancelled tasks return promptly
+    std::unique_lock lock(state.done_mutex);
+    state.done_cv.wait(lock, [&]() { return state.outstanding == 0; });
+
+    return state.solution ? *state.solution : s;
+}
@@ -0,0 +1,11 @@
+﻿// parallel_search.h : Explores the sibling branches of a single puzzle concurrently.
+
+#pragma once
+
+#include "sudoku.h"
+#include "task_pool.h"
+
+// like solve(s), but the branches created in the first split_depth levels of the search are
+// handed to the pool as separate tasks. the first branch to reach is_solved() cancels the rest.
+// returns s unchanged when the puzzle has no solution. must not be called from a pool worker.
+sudoku solve(const sudoku& s, task_pool& pool, int split_depth = 4);
@@ -0,0 +1,250 @@
+﻿// puzzle_format.cpp : Packed binary puzzle files, an occupancy bitmask plus 4 bit digits per grid, with a record index.
+//
+
+#include "puzzle_format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+    constexpr std::size_t mask_size = 11;
+
+    void put_le(char* out, std::uint64_t value, int num_bytes) {
+        for (int i = 0; i < num_bytes; ++i) {
+            out[i] = static_cast<char> (value >> (8 * i));
+        }
+    }
+
+    std::uint64_t get_le(const char* in, int num_bytes) {
+        std::uint64_t value = 0;
+        for (int i = 0; i < num_bytes; ++i) {
+            value |= std::uint64_t{ static_cast<unsigned char> (in[i]) } << (8 * i);
+        }
+        return value;
+    }
+
+    std::array<char, puzzle_format::header_size> make_header(std::uint64_t count, std::uint64_t index_offset) {
+        std::array<char, puzzle_format::header_size> header{};
+        std::copy(puzzle_format::magic.begin(), puzzle_format::magic.end(), header.begin());
+        put_le(header.data() + 4, puzzle_format::version, 2);
+        put_le(header.data() + 8, count, 8);
+        put_le(header.data() + 16, index_offset, 8);
+        put_le(header.data() + 24, puzzle_format::index_stride, 4);
+        return header;
+    }
+
+    // cells 0-63 and 64-80 of the occupancy mask
+    std::array<std::uint64_t, 2> read_mask(const char* in) {
+        return { get_le(in, 8), get_le(in + 8, 3) };
+    }
+
+    std::size_t record_size(const std::array<std::uint64_t, 2>& mask) {
+        int givens = std::popcount(mask[0]) + std::popcount(mask[1]);
+        return mask_size + (givens + 1) / 2;
+    }
+
+    [[noreturn]] void damaged(std::size_t record) {
+        throw std::runtime_error("puzzle record " + std::to_string(record) + " is damaged");
+    }
+}
+
+namespace puzzle_format {
+
+    bool is_binary(std::string_view bytes) {
+        return bytes.size() >= header_size && std::equal(magic.begin(), magic.end(), bytes.begin());
+    }
+
+    std::string_view next_puzzle_line(std::string_view text, std::size_t& pos) {
+        while (pos < text.size()) {
+            const char* begin = text.data() + pos;
+            const void* newline = std::memchr(begin, '\n', text.size() - pos);
+            std::size_t length = newline ? static_cast<const char*> (newline) - begin : text.size() - pos;
+
+            pos += newline ? length + 1 : length;
+            std::string_view line{ begin, length };
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty() && line.front() != '#') {
+                return line;
+            }
+        }
+        return {};
+    }
+
+    bool next_puzzle_line(std::istream& is, std::string& line, long long& line_number) {
+        while (std::getline(is, line)) {
+            ++line_number;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty() && line.front() != '#') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    parse_error locate(std::string_view text, std::string_view line, const parse_error& error) {
+        std::size_t line_start = static_cast<std::size_t> (line.data() - text.data());
+        auto line_number = std::count(text.begin(), text.begin() + line_start, '\n') + 1;
+        return parse_error("line " + std::to_string(line_number) + ": " + error.what(), line_start + error.position());
+    }
+}
+
+puzzle_writer::puzzle_writer(std::ostream& os) : os_(os) {
+    auto header = make_header(0, 0);
+    os_.write(header.data(), header.size());
+}
+
+void puzzle_writer::write(const sudoku& s) {
+    if (count_ % puzzle_format::index_stride == 0) {
+        index_.push_back(offset_);
+    }
+
+    std::array<char, mask_size + 41> record{};
+    std::array<std::uint64_t, 2> mask{};
+    std::size_t size = mask_size;
+    int nibble = 0;
+    for (int i = 0; i < 81; ++i) {
+        int digit = s.grid()[i];
+        if (digit == 0) {
+            continue;
+        }
+
+        mask[i / 64] |= std::uint64_t{ 1 } << (i % 64);
+        record[size] = static_cast<char> (record[size] | (nibble ? digit << 4 : digit));
+        size += nibble;
+        nibble ^= 1;
+    }
+    size += nibble;
+    put_le(record.data(), mask[0], 8);
+    put_le(record.data() + 8, mask[1], 3);
+
+    os_.write(record.data(), size);
+    offset_ += size;
+    ++count_;
+}
+
+void puzzle_writer::finish() {
+    std::vector<char> index(8 * index_.size());
+    for (std::size_t i = 0; i < index_.size(); ++i) {
+        put_le(index.data() + 8 * i, index_[i], 8);
+    }
+    os_.write(index.data(), index.size());
+
+    auto header = make_header(count_, offset_);
+    auto end = os_.tellp();
+    os_.seekp(0);
+    os_.write(header.data(), header.size());
+    os_.seekp(end);
+    os_.flush();
+
+    if (!os_) {
+        throw std::runtime_error("could not write the puzzle file");
+    }
+}
+
+puzzle_reader::puzzle_reader(std::string_view bytes) : bytes_(bytes) {
+    if (!puzzle_format::is_binary(bytes)) {
+        throw std::runtime_error("not a binary puzzle file");
+    }
+    if (get_le(bytes.data() + 4, 2) != puzzle_format::version) {
+        throw std::runtime_error("unsupported binary puzzle file version " + std::to_string(get_le(bytes.data() + 4, 2)));
+    }
+
+    count_ = get_le(bytes.data() + 8, 8);
+    index_offset_ = get_le(bytes.data() + 16, 8);
+    index_stride_ = static_cast<std::uint32_t> (get_le(bytes.data() + 24, 4));
+
+    std::uint64_t index_entries = index_stride_ ? (count_ + index_stride_ - 1) / index_stride_ : 0;
+    if (index_stride_ == 0 || index_offset_ < puzzle_format::header_size || index_offset_ > bytes.size()
+        || (bytes.size() - index_offset_) / 8 < index_entries) {
+        throw std::runtime_error("binary puzzle file is truncated");
+    }
+}
+
+void puzzle_reader::read(std::size_t first, std::span<sudoku> out) const {
+    if (first + out.size() > count_) {
+        throw std::out_of_range("puzzle records out of range");
+    }
+    if (out.empty()) {
+        return;
+    }
+
+    //jump to the closest indexed record, then skip over the record sizes to the first one
+    std::size_t record = first - first % index_stride_;
+    std::uint64_t pos = get_le(bytes_.data() + index_offset_ + 8 * (record / index_stride_), 8);
+
+    auto next_mask = [&]() {
+        if (pos < puzzle_format::header_size || pos + mask_size > index_offset_) damaged(record);
+        auto mask = read_mask(bytes_.data() + pos);
+        if (mask[1] >> 17 || pos + record_size(mask) > index_offset_) damaged(record);
+        return mask;
+    };
+
+    for (; record < first; ++record) {
+        pos += record_size(next_mask());
+    }
+
+    for (auto& s : out) {
+        auto mask = next_mask();
+        const char* digits = bytes_.data() + pos + mask_size;
+
+        std::array<int, 81> grid{};
+        int nibble = 0;
+        for (int w = 0; w < 2; ++w) {
+            for (auto bits = mask[w]; bits; bits &= bits - 1) {
+                int digit = (static_cast<unsigned char> (digits[nibble / 2]) >> (4 * (nibble % 2))) & 0xf;
+                if (digit == 0 || digit > 9) damaged(record);
+                grid[64 * w + std::countr_zero(bits)] = digit;
+                ++nibble;
+            }
+        }
+
+        s = sudoku{ grid };
+        pos += record_size(mask);
+        ++record;
+    }
+}
+
+std::size_t text_to_binary(std::string_view text, std::ostream& os) {
+    puzzle_writer writer(os);
+    std::size_t count = 0;
+    std::size_t pos = 0;
+    for (auto line = puzzle_format::next_puzzle_line(text, pos); !line.empty(); line = puzzle_format::next_puzzle_line(text, pos)) {
+        try {
+            writer.write(parse_sudoku(line));
+        }
+        catch (const parse_error& e) {
+            throw puzzle_format::locate(text, line, e);
+        }
+        ++count;
+    }
+    writer.finish();
+    return count;
+}
+
+std::size_t binary_to_text(std::string_view bytes, std::ostream& os) {
+    puzzle_reader reader(bytes);
+
+    //decode a stride at a time so long archives need no more than a small buffer
+    std::vector<sudoku> chunk(puzzle_format::index_stride, sudoku{ {} });
+    std::string out;
+    for (std::size_t first = 0; first < reader.size(); first += chunk.size()) {
+        std::span<sudoku> records{ chunk.data(), std::min(chunk.size(), reader.size() - first) };
+        reader.read(first, records);
+
+        out.clear();
+        for (const auto& s : records) {
+            out += to_string(s);
+            out += '\n';
+        }
+        os.write(out.data(), static_cast<std::streamsize> (out.size()));
+    }
+    return reader.size();
+}
@@ -0,0 +1,167 @@
+﻿// puzzle_generator.cpp : Random puzzles with a unique solution, graded by what it takes to solve them.
+//
+
+#include "puzzle_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+    // splitmix64, spreads consecutive puzzle indices over unrelated seeds
+    std::uint64_t mix(std::uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    // puzzles per emitted chunk, enough for every worker to have several in flight
+    constexpr int chunk_size = 256;
+}
+
+graded_puzzle grade(const sudoku& puzzle, solver_context& context) {
+    graded_puzzle result{ puzzle };
+    result.clues = static_cast<int> (std::count_if(puzzle.grid().begin(), puzzle.grid().end(), [](auto digit) { return digit != 0; }));
+
+    constexpr std::array<std::pair<technique, difficulty>, 3> ladder = { {
+        { technique::naked_singles, difficulty::easy },
+        { technique::hidden_singles, difficulty::medium },
+        { technique::subsets, difficulty::hard },
+    } };
+
+    sudoku s = puzzle;
+    while (!s.is_solved()) {
+        bool progress = false;
+        for (auto [t, level] : ladder) {
+            const sudoku before = s;
+            const auto stepped = s.step(t);
+            if (stepped == step_result::contradiction) {
+                s = before;
+                break;
+            }
+            if (stepped == step_result::changed) {
+                result.level = std::max(result.level, level);
+                progress = true;
+                break;
+            }
+        }
+
+        if (!progress) {
+            context.solve(s);
+            result.branch_points = context.branch_points();
+            result.level = result.branch_points <= expert_branch_points ? difficulty::expert : difficulty::evil;
+            break;
+        }
+    }
+
+    return result;
+}
+
+puzzle_generator::puzzle_generator(std::uint64_t seed, bool symmetric) : rng_(seed), symmetric_(symmetric) {}
+
+sudoku puzzle_generator::random_grid() {
+    //the diagonal boxes share no unit, any three permutations complete to a full grid
+    std::array<int, 9 * 9> grid{};
+    std::array<int, 9> digits;
+    std::iota(digits.begin(), digits.end(), 1);
+
+    for (int box = 0; box < 3; ++box) {
+        std::shuffle(digits.begin(), digits.end(), rng_);
+        for (int i = 0; i < 9; ++i) {
+            grid[(3 * box + i / 3) * 9 + 3 * box + i % 3] = digits[i];
+        }
+    }
+
+    //mrv would always complete the boxes the same way, only the digits within them would differ
+    filler_.seed(static_cast<std::uint32_t> (rng_()));
+    return filler_.solve(sudoku{ grid });
+}
+
+graded_puzzle puzzle_generator::dig(const sudoku& grid, difficulty target) {
+    std::array<int, 9 * 9> cells;
+    std::copy(grid.grid().begin(), grid.grid().end(), cells.begin());
+
+    //with symmetry cell i goes together with 80 - i, the centre on its own
+    std::array<int, 9 * 9> order;
+    std::iota(order.begin(), order.end(), 0);
+    const int num_candidates = symmetric_ ? 41 : 81;
+    std::shuffle(order.begin(), order.begin() + num_candidates, rng_);
+
+    for (int k = 0; k < num_candidates; ++k) {
+        const int idx = order[k];
+        const int mirror = symmetric_ ? 80 - idx : idx;
+        const int digit = cells[idx];
+        const int mirror_digit = cells[mirror];
+
+        cells[idx] = 0;
+        cells[mirror] = 0;
+
+        sudoku candidate{ cells };
+        if (context_.count_solutions(candidate, 2) != 1 || (target < difficulty::evil && grade(candidate, context_).level > target)) {
+            cells[idx] = digit;
+            cells[mirror] = mirror_digit;
+        }
+    }
+
+    return grade(sudoku{ cells }, context_);
+}
+
+std::optional<graded_puzzle> puzzle_generator::generate(difficulty target, int max_attempts) {
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        auto puzzle = dig(random_grid(), target);
+        if (puzzle.level == target) {
+            return puzzle;
+        }
+    }
+    return std::nullopt;
+}
+
+generate_result generate_puzzles(int count, difficulty target, std::uint64_t seed, task_pool& pool,
+                                 const std::function<void(std::span<const graded_puzzle>)>& emit,
+                                 bool symmetric, int max_attempts) {
+    using double_s = std::chrono::duration<double>;
+
+    generate_result result;
+
+    std::vector<puzzle_generator> generators;
+    generators.reserve(pool.size());
+    for (unsigned i = 0; i < pool.size(); ++i) {
+        generators.emplace_back(seed, symmetric);
+    }
+
+    std::vector<std::optional<graded_puzzle>> slots(chunk_size);
+    std::vector<graded_puzzle> puzzles;
+    puzzles.reserve(chunk_size);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int first = 0; first < count; first += chunk_size) {
+        const int n = std::min(chunk_size, count - first);
+
+        pool.parallel_for(0, n, 1, [&](int begin, int end) {
+            auto& generator = generators[task_pool::worker_index()];
+            for (int i = begin; i < end; ++i) {
+                generator.seed(mix(seed ^ mix(static_cast<std::uint64_t> (first + i))));
+                slots[i] = generator.generate(target, max_attempts);
+            }
+        });
+
+        puzzles.clear();
+        for (int i = 0; i < n; ++i) {
+            if (slots[i]) {
+                puzzles.push_back(*slots[i]);
+            }
+        }
+        result.num_puzzles += static_cast<int> (puzzles.size());
+        result.num_failed += n - static_cast<int> (puzzles.size());
+
+        emit(puzzles);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration_cast<double_s> (end - start).count();
+    return result;
+}
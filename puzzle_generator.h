@@ -0,0 +1,65 @@
+﻿// puzzle_generator.h : Random puzzles with a unique solution, graded by what it takes to solve them.
+
+#pragma once
+
+#include "sudoku.h"
+#include "solver_context.h"
+#include "task_pool.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <span>
+
+struct graded_puzzle {
+    sudoku puzzle;
+    difficulty level{ difficulty::easy };
+    int clues{ 0 };
+    int branch_points{ 0 };     //states the search branched on, 0 when propagation alone solves it
+};
+
+// the hardest technique propagating puzzle needs, applying the cheapest one that still makes progress each step:
+// easy needs naked singles, medium hidden singles and hard subsets. whatever propagation leaves is solved by
+// searching with context, expert takes at most expert_branch_points branch points and evil more
+inline constexpr int expert_branch_points = 2;
+graded_puzzle grade(const sudoku& puzzle, solver_context& context);
+
+// not thread safe, use one per thread
+class puzzle_generator {
+
+    solver_context context_;
+    solver_context filler_{ branch_policy::random };    //completes random grids, reseeded from rng_ for each
+    std::mt19937_64 rng_;
+    bool symmetric_;
+
+public:
+
+    // symmetric puzzles keep the givens symmetric under a half turn of the board
+    explicit puzzle_generator(std::uint64_t seed, bool symmetric = true);
+
+    void seed(std::uint64_t seed) { rng_.seed(seed); }
+
+    // a random solved grid, a search breaking ties at random fills in around three random diagonal boxes
+    sudoku random_grid();
+
+    // removes the clues of grid in random order while the puzzle stays unique and grades no harder than target
+    graded_puzzle dig(const sudoku& grid, difficulty target);
+
+    // digs random grids until one grades exactly as target, nothing after max_attempts grids
+    std::optional<graded_puzzle> generate(difficulty target, int max_attempts);
+};
+
+struct generate_result {
+    int num_puzzles{ 0 };
+    int num_failed{ 0 };            //puzzles for which no grid graded as the target
+    double seconds{ 0.0 };
+
+    double puzzles_per_second() const { return seconds > 0.0 ? num_puzzles / seconds : 0.0; }
+};
+
+// generates count puzzles of target difficulty across the pool, emit receives them chunk by chunk as they
+// are done. puzzle i only depends on seed and i, so the output is the same for any number of threads
+generate_result generate_puzzles(int count, difficulty target, std::uint64_t seed, task_pool& pool,
+                                 const std::function<void(std::span<const graded_puzzle>)>& emit,
+                                 bool symmetric = true, int max_attempts = 1000);
@@ -0,0 +1,319 @@
+﻿// simd_kernels.cpp : Whole-grid kernels with AVX2 implementations picked at runtime by CPUID.
+//
+
+#include "simd_kernels.h"
+#include "sudoku_tables.h"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    using kernels::cell_mask;
+    using kernels::min_cell;
+    using kernels::kernel_set;
+    using kernels::find_kernels;
+
+    // a grid digit as its candidate bit, 0 for an empty cell
+    constexpr std::uint16_t digit_bit(int digit) {
+        return digit ? static_cast<std::uint16_t> (1 << (digit - 1)) : 0;
+    }
+
+    // the bits of distinct digits never carry, so a unit is free of duplicates exactly when the sum equals the or
+    bool unit_is_valid(const std::array<std::uint16_t, 96>& bits, const sudoku_tables::unit_list& idxs) {
+        unsigned sum = 0;
+        unsigned any = 0;
+        for (int idx : idxs) {
+            sum += bits[idx];
+            any |= bits[idx];
+        }
+        return sum == any;
+    }
+
+    cell_mask naked_singles_scalar(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        cell_mask mask{};
+        for (int i = 0; i < 81; ++i) {
+            if (grid[i] == 0 && std::has_single_bit(annotations[i])) {
+                mask[i / 64] |= std::uint64_t{ 1 } << (i % 64);
+            }
+        }
+        return mask;
+    }
+
+    bool validate_scalar(const std::array<std::uint8_t, 81>& grid) {
+        std::array<std::uint16_t, 96> bits{};
+        for (int i = 0; i < 81; ++i) {
+            bits[i] = digit_bit(grid[i]);
+        }
+
+        for (int n = 0; n < 9; ++n) {
+            if (!unit_is_valid(bits, row(n)) || !unit_is_valid(bits, column(n)) || !unit_is_valid(bits, box(n))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    min_cell min_candidate_cell_scalar(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        min_cell best{ -1, 10 };
+        for (int i = 0; i < 81; ++i) {
+            int count = std::popcount(annotations[i]);
+            if (grid[i] == 0 && count >= 2 && count < best.count) {
+                best = { i, count };
+            }
+        }
+        return best;
+    }
+
+    // the digit of one puzzle character, -1 when it is not one
+    int parse_char(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c == '.' || c == ' ') return 0;
+        return -1;
+    }
+
+    int parse_line_scalar(const char* line, std::array<std::uint8_t, 81>& digits) {
+        for (int i = 0; i < 81; ++i) {
+            int digit = parse_char(line[i]);
+            if (digit < 0) {
+                return i;
+            }
+            digits[i] = static_cast<std::uint8_t> (digit);
+        }
+        return -1;
+    }
+
+#if defined(SUDOKU_HAVE_X86)
+
+    SUDOKU_TARGET_AVX2 __m256i popcount_epi16(__m256i v) {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low_nibble));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+        __m256i bytes = _mm256_add_epi8(lo, hi);
+
+        //add the two byte counts of each 16 bit lane
+        return _mm256_add_epi16(_mm256_and_si256(bytes, _mm256_set1_epi16(0x00ff)), _mm256_srli_epi16(bytes, 8));
+    }
+
+    // 16 lanes of all ones or all zeros down to one bit per lane, in lane order
+    SUDOKU_TARGET_AVX2 unsigned lane_mask_epi16(__m256i m) {
+        __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+        return static_cast<unsigned> (_mm_movemask_epi8(packed));
+    }
+
+    SUDOKU_TARGET_AVX2 cell_mask naked_singles_avx2(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi16(1);
+
+        cell_mask mask{};
+        for (int b = 0; b < 5; ++b) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*> (annotations.data() + 16 * b));
+            __m256i g = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*> (grid.data() + 16 * b)));
+
+            //a & (a - 1) == 0 with a != 0 and an empty cell
+            __m256i single = _mm256_cmpeq_epi16(_mm256_and_si256(a, _mm256_sub_epi16(a, one)), zero);
+            single = _mm256_and_si256(single, _mm256_cmpeq_epi16(g, zero));
+            single = _mm256_andnot_si256(_mm256_cmpeq_epi16(a, zero), single);
+
+            //blocks of 16 never straddle a word
+            std::uint64_t lanes = lane_mask_epi16(single);
+            mask[b / 4] |= lanes << (16 * (b % 4));
+        }
+
+        if (grid[80] == 0 && std::has_single_bit(annotations[80])) {
+            mask[1] |= std::uint64_t{ 1 } << (80 - 64);
+        }
+        return mask;
+    }
+
+    SUDOKU_TARGET_AVX2 bool validate_avx2(const std::array<std::uint8_t, 81>& grid) {
+        //digit to bit through two byte lookups, digit 9 is the only one in the high byte
+        const __m128i lut_lo = _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, static_cast<char> (128), 0, 0, 0, 0, 0, 0, 0);
+        const __m128i lut_hi = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0);
+
+        alignas(32) std::array<std::uint16_t, 96> bits{};
+        for (int b = 0; b < 5; ++b) {
+            __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*> (grid.data() + 16 * b));
+            __m128i lo = _mm_shuffle_epi8(lut_lo, g);
+            __m128i hi = _mm_shuffle_epi8(lut_hi, g);
+            _mm_storeu_si128(reinterpret_cast<__m128i*> (bits.data() + 16 * b), _mm_unpacklo_epi8(lo, hi));
+            _mm_storeu_si128(reinterpret_cast<__m128i*> (bits.data() + 16 * b + 8), _mm_unpackhi_epi8(lo, hi));
+        }
+        bits[80] = digit_bit(grid[80]);
+
+        //columns and bands are sums of whole rows, lanes 9-15 of every load belong to the next row and are ignored
+        __m256i column_sum = _mm256_setzero_si256();
+        __m256i column_or = _mm256_setzero_si256();
+        std::array<std::array<std::uint16_t, 16>, 3> band_sum{};
+        std::array<std::array<std::uint16_t, 16>, 3> band_or{};
+
+        for (int band = 0; band < 3; ++band) {
+            __m256i sum = _mm256_setzero_si256();
+            __m256i any = _mm256_setzero_si256();
+            for (int r = 3 * band; r < 3 * band + 3; ++r) {
+                __m256i row_bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*> (bits.data() + 9 * r));
+                sum = _mm256_add_epi16(sum, row_bits);
+                any = _mm256_or_si256(any, row_bits);
+            }
+            column_sum = _mm256_add_epi16(column_sum, sum);
+            column_or = _mm256_or_si256(column_or, any);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*> (band_sum[band].data()), sum);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*> (band_or[band].data()), any);
+        }
+
+        if ((lane_mask_epi16(_mm256_cmpeq_epi16(column_sum, column_or)) & 0x1ff) != 0x1ff) {
+            return false;
+        }
+
+        for (int band = 0; band < 3; ++band) {
+            for (int stack = 0; stack < 3; ++stack) {
+                unsigned sum = 0;
+                unsigned any = 0;
+                for (int c = 3 * stack; c < 3 * stack + 3; ++c) {
+                    sum += band_sum[band][c];
+                    any |= band_or[band][c];
+                }
+                if (sum != any) {
+                    return false;
+                }
+            }
+        }
+
+        for (int n = 0; n < 9; ++n) {
+            if (!unit_is_valid(bits, row(n))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SUDOKU_TARGET_AVX2 min_cell min_candidate_cell_avx2(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi16(1);
+        const __m256i ignored = _mm256_set1_epi16(0xff);
+
+        min_cell best{ -1, 10 };
+        for (int b = 0; b < 5; ++b) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*> (annotations.data() + 16 * b));
+            __m256i g = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*> (grid.data() + 16 * b)));
+
+            //filled cells and cells with fewer than 2 candidates can never be the minimum
+            __m256i count = popcount_epi16(a);
+            __m256i open = _mm256_and_si256(_mm256_cmpeq_epi16(g, zero), _mm256_cmpgt_epi16(count, one));
+            count = _mm256_blendv_epi8(ignored, count, open);
+
+            //minpos gives the lowest value and its first lane, halves are checked in cell order
+            for (int half = 0; half < 2; ++half) {
+                __m128i c = half == 0 ? _mm256_castsi256_si128(count) : _mm256_extracti128_si256(count, 1);
+                unsigned minpos = static_cast<unsigned> (_mm_cvtsi128_si32(_mm_minpos_epu16(c)));
+                int value = static_cast<int> (minpos & 0xffff);
+                if (value < best.count) {
+                    best = { 16 * b + 8 * half + static_cast<int> (minpos >> 16), value };
+                }
+            }
+        }
+
+        int count = std::popcount(annotations[80]);
+        if (grid[80] == 0 && count >= 2 && count < best.count) {
+            best = { 80, count };
+        }
+        return best;
+    }
+
+    SUDOKU_TARGET_AVX2 int parse_line_avx2(const char* line, std::array<std::uint8_t, 81>& digits) {
+        const __m128i zero_char = _mm_set1_epi8('0');
+        const __m128i nine = _mm_set1_epi8(9);
+        const __m128i dot = _mm_set1_epi8('.');
+        const __m128i space = _mm_set1_epi8(' ');
+
+        for (int b = 0; b < 5; ++b) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*> (line + 16 * b));
+
+            //c - '0' wraps around for everything below '0', so one unsigned compare finds the digits
+            __m128i d = _mm_sub_epi8(c, zero_char);
+            __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+            __m128i is_empty = _mm_or_si128(_mm_cmpeq_epi8(c, dot), _mm_cmpeq_epi8(c, space));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*> (digits.data() + 16 * b), _mm_and_si128(d, is_digit));
+
+            unsigned invalid = ~static_cast<unsigned> (_mm_movemask_epi8(_mm_or_si128(is_digit, is_empty))) & 0xffff;
+            if (invalid) {
+                return 16 * b + std::countr_zero(invalid);
+            }
+        }
+
+        int digit = parse_char(line[80]);
+        if (digit < 0) {
+            return 80;
+        }
+        digits[80] = static_cast<std::uint8_t> (digit);
+        return -1;
+    }
+
+    bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+
+        __cpuid(info, 1);
+        bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return os_saves_ymm && (info[1] & (1 << 5));
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#endif
+
+    const kernel_set& active_kernels() {
+        static const kernel_set* const active = []() {
+            const char* forced = std::getenv("SUDOKU_SIMD");
+            bool force_scalar = forced && std::strcmp(forced, "scalar") == 0;
+
+            const kernel_set* avx2 = force_scalar ? nullptr : find_kernels("avx2");
+            return avx2 ? avx2 : find_kernels("scalar");
+        }();
+        return *active;
+    }
+}
+
+namespace kernels {
+
+    const kernel_set* find_kernels(std::string_view isa) {
+        static constexpr kernel_set scalar{ "scalar", naked_singles_scalar, validate_scalar, min_candidate_cell_scalar, parse_line_scalar };
+#if defined(SUDOKU_HAVE_X86)
+        static constexpr kernel_set avx2{ "avx2", naked_singles_avx2, validate_avx2, min_candidate_cell_avx2, parse_line_avx2 };
+        if (isa == "avx2") {
+            return cpu_has_avx2() ? &avx2 : nullptr;
+        }
+#endif
+        return isa == "scalar" ? &scalar : nullptr;
+    }
+
+    cell_mask naked_singles(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        return active_kernels().naked_singles(grid, annotations);
+    }
+
+    bool validate(const std::array<std::uint8_t, 81>& grid) {
+        return active_kernels().validate(grid);
+    }
+
+    min_cell min_candidate_cell(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations) {
+        return active_kernels().min_candidate_cell(grid, annotations);
+    }
+
+    int parse_line(const char* line, std::array<std::uint8_t, 81>& digits) {
+        return active_kernels().parse_line(line, digits);
+    }
+
+    std::string_view active_isa() {
+        return active_kernels().isa;
+    }
+}
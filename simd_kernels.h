@@ -0,0 +1,63 @@
+﻿// simd_kernels.h : Whole-grid kernels with AVX2 implementations picked at runtime by CPUID.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SUDOKU_HAVE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// gcc and clang only emit AVX2 instructions in functions marked for it, msvc always can.
+// only call a marked function when active_isa() is "avx2"
+#if defined(SUDOKU_HAVE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SUDOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SUDOKU_TARGET_AVX2
+#endif
+
+namespace kernels {
+
+    // bit i % 64 of word i / 64 is set for cell i
+    using cell_mask = std::array<std::uint64_t, 2>;
+
+    struct min_cell {
+        int cell_idx;   //-1 when there is no open cell with at least 2 candidates
+        int count;
+    };
+
+    // open cells with exactly one candidate
+    cell_mask naked_singles(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations);
+
+    // no digit appears twice in a row, column or box
+    bool validate(const std::array<std::uint8_t, 81>& grid);
+
+    // the first open cell with the fewest candidates, cells with fewer than 2 are ignored
+    min_cell min_candidate_cell(const std::array<std::uint8_t, 81>& grid, const std::array<std::uint16_t, 81>& annotations);
+
+    // digits of the 81 characters at line, '1'-'9' for givens and '.', '0' or ' ' for empty cells.
+    // returns the position of the first other character, -1 when there is none
+    int parse_line(const char* line, std::array<std::uint8_t, 81>& digits);
+
+    // "avx2" or "scalar". setting SUDOKU_SIMD=scalar in the environment forces the fallback
+    std::string_view active_isa();
+
+    // one implementation of every kernel above
+    struct kernel_set {
+        std::string_view isa;
+        cell_mask (*naked_singles)(const std::array<std::uint8_t, 81>&, const std::array<std::uint16_t, 81>&);
+        bool (*validate)(const std::array<std::uint8_t, 81>&);
+        min_cell (*min_candidate_cell)(const std::array<std::uint8_t, 81>&, const std::array<std::uint16_t, 81>&);
+        int (*parse_line)(const char*, std::array<std::uint8_t, 81>&);
+    };
+
+    // the kernels of "avx2" or "scalar", nullptr when this cpu cannot run them. lets the implementations be
+    // checked against each other whichever one is active
+    const kernel_set* find_kernels(std::string_view isa);
+}
@@ -0,0 +1,273 @@
+﻿// solve_server.cpp : Long running solver that answers puzzle lines from a stream or a Unix socket.
+//
+
+#include "solve_server.h"
+#include "puzzle_format.h"
+#include "spsc_queue.h"
+#include "solver_engine.h"
+#include "sudoku.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <streambuf>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    struct end_of_stream {};
+
+    // a puzzle on the way in, its solution on the way out
+    using message = std::variant<sudoku, parse_error, end_of_stream>;
+
+    struct worker_lane {
+        spsc_queue<message> requests;
+        spsc_queue<message> responses;
+
+        explicit worker_lane(std::size_t capacity) : requests(capacity), responses(capacity) {}
+    };
+
+    void read_stage(std::istream& is, std::vector<std::unique_ptr<worker_lane>>& lanes) {
+        std::string line;
+        long long line_number = 0;
+        std::size_t next = 0;
+
+        while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+            //the lines are dealt round robin so the write stage can collect them in the same order
+            message request = end_of_stream{};
+            try {
+                request = parse_sudoku(line);
+            }
+            catch (const parse_error& e) {
+                request = parse_error("line " + std::to_string(line_number) + ": " + e.what(), e.position());
+            }
+            lanes[next]->requests.push(std::move(request));
+            next = (next + 1) % lanes.size();
+        }
+
+        for (auto& lane : lanes) {
+            lane->requests.push(end_of_stream{});
+        }
+    }
+
+    void solve_stage(worker_lane& lane, std::string_view engine_name, branch_policy policy) {
+        auto engine = make_engine(engine_name, policy);
+
+        for (;;) {
+            auto request = lane.requests.pop();
+            if (auto* puzzle = std::get_if<sudoku>(&request)) {
+                lane.responses.push(engine->solve(*puzzle));
+                continue;
+            }
+
+            bool done = std::holds_alternative<end_of_stream>(request);
+            lane.responses.push(std::move(request));
+            if (done) {
+                return;
+            }
+        }
+    }
+
+    long long write_stage(std::ostream& os, std::vector<std::unique_ptr<worker_lane>>& lanes) {
+        long long answered = 0;
+        std::size_t next = 0;
+        std::string out;
+
+        //every worker ends with exactly one end_of_stream, the first one seen comes right after the last answer
+        for (;;) {
+            auto& responses = lanes[next]->responses;
+
+            //nothing is held back while waiting, which bounds the latency of every answer
+            if (responses.empty()) {
+                os.flush();
+            }
+
+            auto response = responses.pop();
+            if (std::holds_alternative<end_of_stream>(response)) {
+                break;
+            }
+
+            if (auto* solution = std::get_if<sudoku>(&response)) {
+                out = to_string(*solution);
+            }
+            else {
+                out = "error: ";
+                out += std::get<parse_error>(response).what();
+            }
+            out += '\n';
+            os.write(out.data(), static_cast<std::streamsize> (out.size()));
+            ++answered;
+            next = (next + 1) % lanes.size();
+        }
+        os.flush();
+
+        //the other workers only have their end marker left
+        for (std::size_t i = 0; i < lanes.size(); ++i) {
+            if (i != next) {
+                lanes[i]->responses.pop();
+            }
+        }
+        return answered;
+    }
+
+#if !defined(_WIN32)
+
+    // one direction of a connected socket, send never raises SIGPIPE when the client went away
+    class socket_streambuf : public std::streambuf {
+
+        int fd_;
+        std::array<char, 1 << 16> in_;
+        std::array<char, 1 << 16> out_;
+
+    public:
+
+        explicit socket_streambuf(int fd) : fd_(fd) {
+            setg(in_.data(), in_.data(), in_.data());
+            setp(out_.data(), out_.data() + out_.size());
+        }
+
+    protected:
+
+        int_type underflow() override {
+            ssize_t n;
+            do {
+                n = ::recv(fd_, in_.data(), in_.size(), 0);
+            } while (n < 0 && errno == EINTR);
+
+            if (n <= 0) {
+                return traits_type::eof();
+            }
+            setg(in_.data(), in_.data(), in_.data() + n);
+            return traits_type::to_int_type(in_[0]);
+        }
+
+        int_type overflow(int_type c) override {
+            if (sync() != 0) {
+                return traits_type::eof();
+            }
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() override {
+            for (const char* p = pbase(); p < pptr();) {
+                ssize_t n = ::send(fd_, p, pptr() - p, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return -1;
+                }
+                p += n;
+            }
+            setp(out_.data(), out_.data() + out_.size());
+            return 0;
+        }
+    };
+
+#endif
+}
+
+long long serve_stream(std::istream& is, std::ostream& os, const server_options& options) {
+    std::vector<std::unique_ptr<worker_lane>> lanes;
+    for (unsigned i = 0; i < std::max(options.num_workers, 1u); ++i) {
+        lanes.push_back(std::make_unique<worker_lane>(std::max<std::size_t>(options.queue_capacity, 1)));
+    }
+
+    //make_engine throws for an unknown name, better here than on a worker
+    make_engine(options.engine);
+
+    //the read stage must not flush os from its own thread, as std::cin does for std::cout
+    is.tie(nullptr);
+
+    std::vector<std::thread> threads;
+    for (auto& lane : lanes) {
+        threads.emplace_back(solve_stage, std::ref(*lane), options.engine, options.policy);
+    }
+    std::thread reader(read_stage, std::ref(is), std::ref(lanes));
+
+    auto answered = write_stage(os, lanes);
+
+    reader.join();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return answered;
+}
+
+#if !defined(_WIN32)
+
+void serve_socket(const std::string& path, const server_options& options) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path is too long: " + path);
+    }
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw std::runtime_error(std::string("could not create a socket: ") + std::strerror(errno));
+    }
+
+    //a socket file left behind by an earlier run would make bind fail. anything else at path is not ours
+    //to remove
+    struct stat existing;
+    if (::lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            ::close(listener);
+            throw std::runtime_error("could not listen on " + path + ": " + std::strerror(EADDRINUSE) + ", it exists and is not a socket");
+        }
+        ::unlink(path.c_str());
+    }
+    if (::bind(listener, reinterpret_cast<const sockaddr*> (&address), sizeof(address)) != 0 || ::listen(listener, 16) != 0) {
+        std::string reason = std::strerror(errno);
+        ::close(listener);
+        throw std::runtime_error("could not listen on " + path + ": " + reason);
+    }
+
+    for (;;) {
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::string reason = std::strerror(errno);
+            ::close(listener);
+            throw std::runtime_error("could not accept on " + path + ": " + reason);
+        }
+
+        //separate buffers for the reading and the writing thread
+        auto in_buffer = std::make_unique<socket_streambuf>(connection);
+        auto out_buffer = std::make_unique<socket_streambuf>(connection);
+        std::istream in(in_buffer.get());
+        std::ostream out(out_buffer.get());
+        serve_stream(in, out, options);
+        ::close(connection);
+    }
+}
+
+#else
+
+void serve_socket(const std::string& path, const server_options&) {
+    throw std::runtime_error("unix sockets are not supported on this platform, cannot listen on " + path);
+}
+
+#endif
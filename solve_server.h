@@ -0,0 +1,29 @@
+﻿// solve_server.h : Long running solver that answers puzzle lines from a stream or a Unix socket.
+//
+// every line is answered with one line in input order: the solution (or the puzzle unchanged when it has none),
+// or "error: " and the reason for a line that is not a puzzle. reading and parsing, solving and formatting
+// run on their own threads joined by bounded lock-free queues, so a client that stops reading eventually
+// stops the server from reading more
+
+#pragma once
+
+#include "sudoku.h"
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+struct server_options {
+    unsigned num_workers{ 1 };
+    std::string_view engine{ "rules" };
+    branch_policy policy{ branch_policy::mrv };
+    std::size_t queue_capacity{ 256 };   //requests per worker queue
+};
+
+// serves until is ends, returns the number of lines answered
+long long serve_stream(std::istream& is, std::ostream& os, const server_options& options);
+
+// listens on a Unix socket at path and serves one connection after another until the process is stopped.
+// a socket already at path is replaced, any other file is left alone. throws std::runtime_error when the
+// socket cannot be set up, path holds something else, or on platforms without Unix sockets
+void serve_socket(const std::string& path, const server_options& options);
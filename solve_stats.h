@@ -0,0 +1,70 @@
+﻿// solve_stats.h : Search counters per solve, compiled out unless SUDOKU_STATS is defined (cmake -DSUDOKU_STATS=ON).
+
+#pragma once
+
+struct solve_stats {
+    long long advance_steps{ 0 };         //sudoku::step calls
+    long long naked_singles{ 0 };         //placements of a cell's last candidate, including those of the propagation cascade
+    long long hidden_singles{ 0 };        //placements of a digit's last place in a unit
+    long long subset_eliminations{ 0 };   //candidates removed by naked and hidden subsets
+    long long branches{ 0 };              //states created by branching
+    long long backtracks{ 0 };            //states dropped after a contradiction
+    long long max_depth{ 0 };             //deepest search stack
+
+    // sums the counters, keeps the larger depth
+    solve_stats& operator+=(const solve_stats& o) {
+        advance_steps += o.advance_steps;
+        naked_singles += o.naked_singles;
+        hidden_singles += o.hidden_singles;
+        subset_eliminations += o.subset_eliminations;
+        branches += o.branches;
+        backtracks += o.backtracks;
+        max_depth = max_depth > o.max_depth ? max_depth : o.max_depth;
+        return *this;
+    }
+};
+
+namespace stats {
+
+#if defined(SUDOKU_STATS)
+    inline constexpr bool enabled = true;
+
+    // where this thread's counters go, nullptr when nobody collects
+    inline thread_local solve_stats* sink = nullptr;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    inline void add(long long solve_stats::* counter, long long n = 1) {
+#if defined(SUDOKU_STATS)
+        if (sink) sink->*counter += n;
+#else
+        (void)counter;
+        (void)n;
+#endif
+    }
+
+    inline void depth(long long d) {
+#if defined(SUDOKU_STATS)
+        if (sink && d > sink->max_depth) sink->max_depth = d;
+#else
+        (void)d;
+#endif
+    }
+
+    // sends the counters of this thread to target while alive
+    class scope {
+#if defined(SUDOKU_STATS)
+        solve_stats* previous_;
+
+    public:
+        explicit scope(solve_stats& target) : previous_(sink) { sink = &target; }
+        ~scope() { sink = previous_; }
+#else
+    public:
+        explicit scope(solve_stats&) {}
+#endif
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+    };
+}
@@ -0,0 +1,96 @@
+﻿// solver_context.cpp : Reusable search state so repeated solves do not touch the allocator.
+//
+
+#include "solver_context.h"
+
+#include <bit>
+#include <variant>
+
+solver_context::solver_context(branch_policy policy, std::uint32_t seed) : policy_(policy), random_state_(seed ? seed : 1) {
+    //a choice point per placement at most
+    choice_points_.reserve(81);
+}
+
+template <typename OnSolved>
+void solver_context::search(const sudoku& s, OnSolved&& on_solved) {
+    stats_ = {};
+    stats::scope collect(stats_);
+    branch_points_ = 0;
+
+    trail_.clear();
+    choice_points_.clear();
+    sudoku current = s;
+    current.attach(&trail_);
+
+    //back to the newest choice point with an untried choice and take it, false once there is none left.
+    //choices are taken from the highest bit down
+    const auto backtrack = [&]() {
+        while (!choice_points_.empty()) {
+            auto& point = choice_points_.back();
+            current.unwind(point.mark);
+            if (!point.remaining) {
+                choice_points_.pop_back();
+                continue;
+            }
+
+            const int choice = std::bit_width(point.remaining) - 1;
+            point.remaining &= ~(1u << choice);
+            if (std::visit([&](const auto& action) { return current.choose(action, choice); }, point.action)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    while (true) {
+        if (current.advance() == step_result::contradiction) {
+            stats::add(&solve_stats::backtracks);
+            if (!backtrack()) {
+                return;
+            }
+            continue;
+        }
+
+        if (current.is_solved()) {
+            if (!on_solved(current) || !backtrack()) {
+                return;
+            }
+            continue;
+        }
+
+        //stuck, branch from here
+        ++branch_points_;
+
+        //xorshift, only the random policy looks at the seed
+        random_state_ ^= random_state_ << 13;
+        random_state_ ^= random_state_ >> 17;
+        random_state_ ^= random_state_ << 5;
+
+        if (auto action_choice = sudoku::select_action(current, policy_, random_state_)) {
+            const auto remaining = std::visit([&](const auto& action) { return sudoku::choices(current, action); }, *action_choice);
+            choice_points_.push_back({ trail_.mark(), *action_choice, remaining });
+            stats::depth(static_cast<long long> (choice_points_.size()));
+        }
+        if (!backtrack()) {
+            return;
+        }
+    }
+}
+
+sudoku solver_context::solve(const sudoku& s) {
+    sudoku solution = s;
+    search(s, [&](const sudoku& solved) {
+        solution = solved;
+        return false;
+    });
+    return solution;
+}
+
+int solver_context::count_solutions(const sudoku& s, int limit) {
+    //branches never overlap, so every solution is reached exactly once
+    int count = 0;
+    search(s, [&](const sudoku&) {
+        return ++count < limit;
+    });
+    return count;
+}
@@ -0,0 +1,55 @@
+﻿// solver_context.h : Reusable search state so repeated solves do not touch the allocator.
+
+#pragma once
+
+#include "sudoku.h"
+#include "solve_stats.h"
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+class solver_context {
+
+    // an action that was branched on, the state it branched from is the one at mark on the trail
+    struct choice_point {
+        std::size_t mark;
+        std::variant<cell_action, unit_action> action;
+        std::uint16_t remaining;        //see sudoku::choices
+    };
+
+    // the search works on one state and backtracks by unwinding the trail, a choice point per level
+    // is all it keeps of the states above
+    sudoku_trail trail_;
+    std::vector<choice_point> choice_points_;
+    solve_stats stats_;
+    branch_policy policy_;
+    std::uint32_t random_state_;
+    int branch_points_{ 0 };
+
+private:
+
+    // depth first search from s, on_solved(solution) returns whether to keep searching
+    template <typename OnSolved>
+    void search(const sudoku& s, OnSolved&& on_solved);
+
+public:
+
+    explicit solver_context(branch_policy policy = branch_policy::mrv, std::uint32_t seed = 0x2545f491);
+
+    // restarts the sequence the random policy breaks ties with
+    void seed(std::uint32_t seed) { random_state_ = seed ? seed : 1; }
+
+    // depth first search from s, returns s when there is no solution
+    sudoku solve(const sudoku& s);
+
+    // explores the whole search tree from s and returns the number of solutions, stopping at limit.
+    // a limit of 2 is enough to tell whether a puzzle is unique
+    int count_solutions(const sudoku& s, int limit = 2);
+
+    // counters of the last solve, all zero unless built with SUDOKU_STATS
+    const solve_stats& stats() const { return stats_; }
+
+    // states the last search had to branch on, counted in every build
+    int branch_points() const { return branch_points_; }
+};
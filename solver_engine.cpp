@@ -0,0 +1,23 @@
+﻿// solver_engine.cpp : Common interface for the solving backends so they can be chosen at runtime.
+//
+
+#include "solver_engine.h"
+#include "dlx_engine.h"
+
+#include <stdexcept>
+#include <string>
+
+std::unique_ptr<solver_engine> make_engine(std::string_view name, branch_policy policy) {
+    if (name == "rules") {
+        return std::make_unique<rules_engine>(policy);
+    }
+    if (name == "dlx") {
+        return std::make_unique<dlx_engine>();
+    }
+    throw std::invalid_argument("unknown solver engine: " + std::string(name));
+}
+
+const std::vector<std::string_view>& engine_names() {
+    static const std::vector<std::string_view> names = { "rules", "dlx" };
+    return names;
+}
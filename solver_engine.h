@@ -0,0 +1,46 @@
+﻿// solver_engine.h : Common interface for the solving backends so they can be chosen at runtime.
+
+#pragma once
+
+#include "sudoku.h"
+#include "solver_context.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class solver_engine {
+public:
+    virtual ~solver_engine() = default;
+
+    virtual std::string_view name() const = 0;
+
+    // returns s when there is no solution. an engine is not thread safe, use one per thread
+    virtual sudoku solve(const sudoku& s) = 0;
+
+    // number of solutions of s, stopping the search once limit are found
+    virtual int count_solutions(const sudoku& s, int limit) = 0;
+
+    // counters of the last solve, all zero unless built with SUDOKU_STATS
+    virtual const solve_stats& stats() const = 0;
+};
+
+// the propagation and branching search of sudoku::step / sudoku::branch
+class rules_engine : public solver_engine {
+
+    solver_context context_;
+
+public:
+
+    explicit rules_engine(branch_policy policy = branch_policy::mrv) : context_(policy) {}
+
+    std::string_view name() const override { return "rules"; }
+    sudoku solve(const sudoku& s) override { return context_.solve(s); }
+    int count_solutions(const sudoku& s, int limit) override { return context_.count_solutions(s, limit); }
+    const solve_stats& stats() const override { return context_.stats(); }
+};
+
+// "rules" or "dlx", throws std::invalid_argument for anything else. the policy only steers the rules engine
+std::unique_ptr<solver_engine> make_engine(std::string_view name, branch_policy policy = branch_policy::mrv);
+
+const std::vector<std::string_view>& engine_names();
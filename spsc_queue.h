@@ -0,0 +1,57 @@
+﻿// spsc_queue.h : Bounded lock-free queue between one producer thread and one consumer thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <vector>
+
+template <class T>
+class spsc_queue {
+
+    std::vector<std::optional<T>> slots_;
+
+    //the indices only grow, their difference is the fill level. each sits on its own cache line
+    alignas(64) std::atomic<std::size_t> head_{ 0 };   //next slot to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };   //next slot to push, written by the producer
+
+public:
+
+    explicit spsc_queue(std::size_t capacity) : slots_(capacity) {}
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    // blocks while the queue is full, which is how a slow consumer holds back the producer
+    void push(T value) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        for (auto head = head_.load(std::memory_order_acquire); tail - head == slots_.size(); head = head_.load(std::memory_order_acquire)) {
+            head_.wait(head, std::memory_order_acquire);
+        }
+
+        slots_[tail % slots_.size()].emplace(std::move(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    // blocks while the queue is empty
+    T pop() {
+        const auto head = head_.load(std::memory_order_relaxed);
+        for (auto tail = tail_.load(std::memory_order_acquire); tail == head; tail = tail_.load(std::memory_order_acquire)) {
+            tail_.wait(tail, std::memory_order_acquire);
+        }
+
+        auto& slot = slots_[head % slots_.size()];
+        T value = std::move(*slot);
+        slot.reset();
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return value;
+    }
+
+    // only meaningful on the consumer side, where it can only turn from true to false
+    bool empty() const {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,1135 @@
+﻿// sudoku.cpp : Solving operations for the sudoku state.
+//
+
+#include "sudoku.h"
+#include "variant_sudoku.h"
+#include "sudoku_tables.h"
+#include "solver_context.h"
+#include "simd_kernels.h"
+#include "solve_stats.h"
+
+#include <algorithm>
+#include <cassert>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+sudoku::sudoku(std::array<int, 9 * 9> grid, const variant_tables& tables) : tables_(&tables) {
+    //givens are assigned without propagation, the annotations are built once from their peers
+    for (int i = 0; i < 81; ++i) {
+        if (grid[i]) {
+            assign(i, grid[i]);
+        }
+    }
+    load_annotate();
+}
+
+void sudoku::assign(int idx, int digit) {
+    record(idx);
+    --open_cells_;
+    grid_[idx] = static_cast<std::uint8_t> (digit);
+    annotations_[idx] = static_cast<std::uint16_t> (1 << (digit - 1));
+}
+
+void sudoku::restore(const sudoku_trail::entry& e) {
+    const int idx = e.idx;
+    record(idx);
+    open_cells_ += (e.digit == 0) - (grid_[idx] == 0);
+    grid_[idx] = e.digit;
+    annotations_[idx] = e.annotation;
+}
+
+void sudoku::unwind(std::size_t mark) {
+    auto& entries = trail_.trail->entries_;
+    sudoku_trail* trail = std::exchange(trail_.trail, nullptr);
+    while (entries.size() > mark) {
+        restore(entries.back());
+        entries.pop_back();
+    }
+    trail_.trail = trail;
+}
+
+void sudoku::undo(std::span<const sudoku_trail::entry> entries) {
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        restore(*it);
+    }
+}
+
+bool sudoku::place(int idx, int digit) {
+    //every placement removes its digit from the peers, peers left with a single
+    //candidate are placed in turn. a cell is only queued once, when it is assigned.
+    //a peer left with no candidate ends the propagation, the state is dead, and so does
+    //a peer already holding the digit: two peers can be left with the same single at once
+    std::array<std::uint8_t, 81> queue;
+    int head = 0;
+    int tail = 0;
+
+    assign(idx, digit);
+    queue[tail++] = static_cast<std::uint8_t> (idx);
+
+    while (head < tail) {
+        int cell = queue[head++];
+        const std::uint16_t bit = annotations_[cell];
+
+        for (int peer : tables_->peers(cell)) {
+            if (annotations_[peer] & bit) {
+                if (grid_[peer] != 0) {
+                    return false;
+                }
+                record(peer);
+                annotations_[peer] &= ~bit;
+
+                if (annotations_[peer] == 0) {
+                    return false;
+                }
+                if (std::has_single_bit(annotations_[peer])) {
+                    stats::add(&solve_stats::naked_singles);
+                    assign(peer, std::countr_zero(annotations_[peer]) + 1);
+                    queue[tail++] = static_cast<std::uint8_t> (peer);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void sudoku::load_annotate() {
+    //every puzzle is built at least once, so plain grids take the digits of their rows, columns and boxes
+    //instead of walking the peers of every given
+    if (tables_->classic()) {
+        std::array<std::uint16_t, 27> placed{};
+        for (int i = 0; i < 81; ++i) {
+            if (grid_[i] != 0) {
+                for (int u : { i / 9, 9 + i % 9, 18 + sudoku_tables::box_of(i) }) {
+                    valid_ = valid_ && !(placed[u] & annotations_[i]);
+                    placed[u] |= annotations_[i];
+                }
+            }
+        }
+        for (int i = 0; i < 81; ++i) {
+            if (grid_[i] == 0) {
+                annotations_[i] = 0b111111111 & ~(placed[i / 9] | placed[9 + i % 9] | placed[18 + sudoku_tables::box_of(i)]);
+            }
+        }
+        return;
+    }
+
+    //the digits given to the peers of every cell
+    std::array<std::uint16_t, 81> seen{};
+    for (int i = 0; i < 81; ++i) {
+        if (grid_[i] != 0) {
+            for (int peer : tables_->peers(i)) {
+                seen[peer] |= annotations_[i];
+            }
+        }
+    }
+
+    //a given seeing its own digit means the givens clash
+    for (int i = 0; i < 81; ++i) {
+        if (grid_[i] == 0) {
+            annotations_[i] = 0b111111111 & ~seen[i];
+        }
+        else if (seen[i] & annotations_[i]) {
+            valid_ = false;
+        }
+    }
+}
+
+bool sudoku::cage_digits(int unit_idx, std::uint16_t& allowed, std::uint16_t& required) const {
+    const auto& u = tables_->units()[unit_idx];
+    std::uint16_t placed = 0;
+    std::uint16_t open = 0;
+    for (int i = 0; i < u.size; ++i) {
+        (grid_[u.cells[i]] ? placed : open) |= annotations_[u.cells[i]];
+    }
+
+    //a digit set fits while it holds the placed digits and the open cells can still take the rest
+    allowed = 0;
+    required = 0b111111111;
+    bool any = false;
+    for (std::uint16_t combo : u.combos) {
+        if ((combo & placed) == placed && !(combo & ~placed & ~open)) {
+            allowed |= combo;
+            required &= combo;
+            any = true;
+        }
+    }
+    allowed &= ~placed;
+    required &= ~placed;
+    return any;
+}
+
+std::uint16_t sudoku::required_digits(int unit_idx) const {
+    const auto& u = tables_->units()[unit_idx];
+    if (u.size == 9) {
+        return 0b111111111;
+    }
+
+    std::uint16_t allowed = 0;
+    std::uint16_t required = 0;
+    if (u.combos.empty() || !cage_digits(unit_idx, allowed, required)) {
+        return 0;
+    }
+    return required;
+}
+
+bool sudoku::sums_hold() const {
+    for (int k : tables_->summed_units()) {
+        const auto& u = tables_->units()[k];
+        std::uint16_t digits = 0;
+        for (int i = 0; i < u.size; ++i) {
+            digits |= annotations_[u.cells[i]];
+        }
+        if (std::find(u.combos.begin(), u.combos.end(), digits) == u.combos.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+step_result sudoku::solve_naked_singles() {
+    auto result = step_result::stuck;
+    //a placement only ever turns a single into a filled cell or a dead end, so the mask taken up front stays sound
+    auto singles = kernels::naked_singles(grid_, annotations_);
+    for (int w = 0; w < 2; ++w) {
+        for (auto bits = singles[w]; bits; bits &= bits - 1) {
+            int idx = 64 * w + std::countr_zero(bits);
+            const auto annotation = annotations_[idx];
+
+            if (grid_[idx] == 0 && std::has_single_bit(annotation)) {
+                stats::add(&solve_stats::naked_singles);
+                if (!place(idx, std::countr_zero(annotation) + 1)) {
+                    return step_result::contradiction;
+                }
+                result = step_result::changed;
+            }
+        }
+    }
+    return result;
+}
+
+step_result sudoku::solve_hidden_singles() {
+    auto result = step_result::stuck;
+    //every unit of 9 cells holds each digit once
+    auto hidden_singles = [&](const variant_tables::unit_cells& u) {
+        const auto& idxs = u.cells;
+
+        std::array<int, 9> counts{};
+        std::array<int, 9> location{};
+        
+        for (int idx : idxs) {
+            if (annotations_[idx] == 0) {
+                return false;
+            }
+            for (int n = 0; n < 9; ++n) {
+                bool is_set_already = (grid_[idx] == n + 1);
+                bool has_annotation = (annotations_[idx] & 1 << n);
+                
+                counts[n] += 2 * is_set_already;
+                counts[n] += 1 * has_annotation;
+                location[n] += idx * has_annotation;
+            }
+        }
+        
+        for (int n = 0; n < 9; ++n) {
+            //a digit with no place left, or whose only place was taken by another digit in this pass
+            if (counts[n] == 0) {
+                return false;
+            }
+            if (counts[n] != 1 || grid_[location[n]] == n + 1) {
+                continue;
+            }
+            if (grid_[location[n]] != 0 || !(annotations_[location[n]] & 1 << n)) {
+                return false;
+            }
+
+            stats::add(&solve_stats::hidden_singles);
+            if (!place(location[n], n + 1)) {
+                return false;
+            }
+            result = step_result::changed;
+        }
+
+        return true;
+    };
+
+    //a summed cage holds one of the digit sets adding up to its sum, the digits in none of them go from its cells
+    //and the ones in all of them are placed like hidden singles
+    auto cage_singles = [&](int unit_idx) {
+        const auto& u = tables_->units()[unit_idx];
+        std::uint16_t allowed;
+        std::uint16_t required;
+        if (!cage_digits(unit_idx, allowed, required)) {
+            return false;
+        }
+
+        bool restricted = false;
+        std::uint16_t once = 0;
+        std::uint16_t twice = 0;
+        for (int i = 0; i < u.size; ++i) {
+            const int idx = u.cells[i];
+            if (grid_[idx] != 0) {
+                continue;
+            }
+            if (annotations_[idx] & ~allowed) {
+                record(idx);
+                annotations_[idx] &= allowed;
+                if (annotations_[idx] == 0) {
+                    return false;
+                }
+                restricted = true;
+            }
+            twice |= once & annotations_[idx];
+            once |= annotations_[idx];
+        }
+
+        //the digit sets are stale once a cell lost candidates, the next step takes the cage up again
+        if (restricted) {
+            result = step_result::changed;
+            return true;
+        }
+        if (required & ~once) {
+            return false;
+        }
+        if (std::uint16_t hidden = required & ~twice) {
+            const int n = std::countr_zero(hidden);
+            for (int i = 0; i < u.size; ++i) {
+                if (grid_[u.cells[i]] == 0 && (annotations_[u.cells[i]] & 1 << n)) {
+                    stats::add(&solve_stats::hidden_singles);
+                    if (!place(u.cells[i], n + 1)) {
+                        return false;
+                    }
+                    result = step_result::changed;
+                    break;
+                }
+            }
+        }
+        return true;
+    };
+
+    for (const auto& u : tables_->units()) {
+        if (u.size == 9 && !hidden_singles(u)) {
+            return step_result::contradiction;
+        }
+    }
+    for (int unit_idx : tables_->summed_units()) {
+        if (!cage_singles(unit_idx)) {
+            return step_result::contradiction;
+        }
+    }
+    return result;
+}
+
+namespace {
+    // calls found(members, span) for every set of up to max_size members whose masks together
+    // span exactly as many bits as there are members. sets are grown in index order and
+    // abandoned as soon as their span is wider than max_size
+    template <typename Fn>
+    void find_subsets(const std::array<unsigned, 9>& masks, int n, int max_size, Fn&& found) {
+        //members wider than max_size can never be part of a set
+        std::array<unsigned, 9> eligible{};
+        std::array<int, 9> eligible_idx{};
+        int num_eligible = 0;
+        for (int i = 0; i < n; ++i) {
+            int count = std::popcount(masks[i]);
+            if (count > 0 && count <= max_size) {
+                eligible[num_eligible] = masks[i];
+                eligible_idx[num_eligible++] = i;
+            }
+        }
+
+        const auto grow = [&](auto& self, int next, unsigned members, unsigned span, int size) -> void {
+            for (int i = next; i < num_eligible; ++i) {
+                unsigned new_span = span | eligible[i];
+                int width = std::popcount(new_span);
+                if (width > max_size) continue;
+
+                unsigned new_members = members | 1u << eligible_idx[i];
+                if (width == size + 1) {
+                    found(new_members, new_span);
+                }
+                if (size + 1 < max_size) {
+                    self(self, i + 1, new_members, new_span, size + 1);
+                }
+            }
+        };
+
+        grow(grow, 0, 0u, 0u, 0);
+    }
+}
+
+step_result sudoku::annotate_subsets() {
+    // a naked k-subset of n open cells is the complement of a hidden (n - k)-subset, so naked
+    // subsets up to 4 plus hidden subsets up to n - 5 find everything without overlap
+    constexpr int max_subset = 4;
+    int eliminated = 0;
+
+    auto subsets = [&](const variant_tables::unit_cells& u) {
+        const auto idxs = std::span(u.cells).first(u.size);
+
+        std::array<int, 9> frontier{}; //enough space for the entire unit
+        std::array<unsigned, 9> candidates{};
+        int to_insert = 0;
+        for (int idx : idxs) {
+            if (grid_[idx] == 0) {
+                candidates[to_insert] = annotations_[idx];
+                frontier[to_insert++] = idx;
+            }
+        }
+
+        // naked: k cells whose candidates together span only k digits, the digits go from the other cells
+        find_subsets(candidates, to_insert, std::min(max_subset, to_insert - 1), [&](unsigned cells, unsigned digits) {
+            if (std::popcount(cells) < 2) return;
+            for (int r = 0; r < to_insert; ++r) {
+                if (!(cells & 1u << r) && (annotations_[frontier[r]] & digits)) {
+                    const int removed = std::popcount(annotations_[frontier[r]] & digits);
+                    stats::add(&solve_stats::subset_eliminations, removed);
+                    eliminated += removed;
+                    record(frontier[r]);
+                    annotations_[frontier[r]] &= ~digits;
+                }
+            }
+        });
+
+        // hidden: k digits that together fit in only k cells, those cells keep only these digits. only
+        // units of 9 cells have to hold every digit
+        if (int max_hidden = u.size == 9 ? std::min(max_subset, to_insert - 1 - max_subset) : 0; max_hidden > 0) {
+            std::array<unsigned, 9> positions{};
+            for (int r = 0; r < to_insert; ++r) {
+                for (unsigned bits = annotations_[frontier[r]]; bits; bits &= bits - 1) {
+                    positions[std::countr_zero(bits)] |= 1u << r;
+                }
+            }
+
+            find_subsets(positions, 9, max_hidden, [&](unsigned digits, unsigned cells) {
+                for (unsigned bits = cells; bits; bits &= bits - 1) {
+                    const int idx = frontier[std::countr_zero(bits)];
+                    if (!(annotations_[idx] & ~digits)) {
+                        continue;
+                    }
+                    const int removed = std::popcount(annotations_[idx] & ~digits);
+                    stats::add(&solve_stats::subset_eliminations, removed);
+                    eliminated += removed;
+                    record(idx);
+                    annotations_[idx] &= digits;
+                }
+            });
+        }
+
+        //eliminations only come from subsets that cannot all hold, an emptied cell means the state is dead
+        for (int r = 0; r < to_insert; ++r) {
+            if (annotations_[frontier[r]] == 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const auto& units = tables_->units();
+    for (int j = 0; j < static_cast<int> (units.size()); ++j) {
+        //boxes, then columns and rows, then the units of the rules
+        const int unit_idx = j < 9 ? 18 + j : j < 27 ? j - 9 : j;
+        if (!subsets(units[unit_idx])) {
+            return step_result::contradiction;
+        }
+    }
+    return eliminated > 0 ? step_result::changed : step_result::stuck;
+}
+
+namespace {
+    // changed when either step changed anything, callers return contradictions before combining
+    step_result combine(step_result a, step_result b) {
+        return a == step_result::changed ? a : b;
+    }
+}
+
+step_result sudoku::step() {
+    stats::add(&solve_stats::advance_steps);
+    return step(technique::subsets);
+}
+
+step_result sudoku::step(technique up_to) {
+    if (!valid_) {
+        return step_result::contradiction;
+    }
+
+    // solving operations, a wipeout ends the step right away
+    const auto naked = solve_naked_singles();
+    if (naked == step_result::contradiction) {
+        return naked;
+    }
+    const auto hidden = up_to >= technique::hidden_singles ? solve_hidden_singles() : step_result::stuck;
+    if (hidden == step_result::contradiction) {
+        return hidden;
+    }
+
+    //placements already updated their peers
+    const auto subsets = up_to >= technique::subsets ? annotate_subsets() : step_result::stuck;
+    return subsets == step_result::contradiction ? subsets : combine(combine(naked, hidden), subsets);
+}
+
+step_result sudoku::advance() {
+    //a filled grid of clashing givens never gets to step
+    if (!valid_) {
+        return step_result::contradiction;
+    }
+
+    auto result = step_result::stuck;
+    while (open_cells_ > 0) {
+        const auto r = step();
+        if (r != step_result::changed) {
+            return r == step_result::contradiction ? r : result;
+        }
+        result = step_result::changed;
+    }
+    //the cells of a summed cage can all differ and still miss its sum
+    if (open_cells_ == 0 && !sums_hold()) {
+        return step_result::contradiction;
+    }
+    return result;
+}
+
+bool sudoku::is_solved() const {
+    return open_cells_ == 0 && valid_ && sums_hold();
+}
+
+bool sudoku::validate(const sudoku& s) {
+    if (s.tables_->classic()) {
+        return kernels::validate(s.grid_);
+    }
+    for (int i = 0; i < 81; ++i) {
+        for (int peer : s.tables_->peers(i)) {
+            if (s.grid_[i] != 0 && s.grid_[peer] == s.grid_[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<cell_action> sudoku::get_minimal_cell_actions(const sudoku& s, int branch_factor) {
+
+    std::vector<cell_action> list;
+
+    for (int i = 0; i < 81; ++i) {
+        if (std::popcount(static_cast<unsigned> (s.annotations_[i])) == branch_factor && s.grid_[i] == 0) {
+            list.emplace_back(i);
+        }
+    }
+
+    return list;
+}
+
+std::vector<unit_action> sudoku::get_minimal_unit_actions(const sudoku& s, int branch_factor) {
+    std::vector<unit_action> list;
+
+    const auto& units = s.tables_->units();
+    for (int k = 0; k < static_cast<int> (units.size()); ++k) {
+        const auto idxs = std::span(units[k].cells).first(units[k].size);
+        for (unsigned digits = s.required_digits(k); digits; digits &= digits - 1) {
+            const int n = std::countr_zero(digits);
+            int count = std::count_if(idxs.begin(), idxs.end(), [&](int idx) {
+                return (s.annotations_[idx] & 1 << n) && s.grid_[idx] == 0;
+                });
+
+            if (count == branch_factor) {
+                list.emplace_back(units[k].type, k, n+1);
+            }
+        }
+    }
+
+    return list;
+}
+
+std::vector<std::variant<cell_action, unit_action>> sudoku::get_minimal_actions(const sudoku& s, int branch_factor) {
+    
+    // find all cell actions
+    auto cell_actions = get_minimal_cell_actions(s, branch_factor);
+    // find all unit actions
+    auto unit_actions = get_minimal_unit_actions(s, branch_factor);
+    //merge lists
+    std::vector<std::variant<cell_action, unit_action>> list;
+    list.reserve(cell_actions.size() + unit_actions.size());
+    std::transform(cell_actions.begin(), cell_actions.end(), std::back_inserter(list), [](const auto action) {
+        return std::variant<cell_action, unit_action> { action };
+        });
+    std::transform(unit_actions.begin(), unit_actions.end(), std::back_inserter(list), [](const auto action) {
+        return std::variant<cell_action, unit_action> { action };
+        });
+    return list;
+}
+
+std::optional<std::variant<cell_action, unit_action>> sudoku::get_minimal_action(const sudoku& s) {
+    return select_action(s, branch_policy::mrv);
+}
+
+std::optional<std::variant<cell_action, unit_action>> sudoku::select_action(const sudoku& s, branch_policy policy, std::uint32_t seed) {
+    //lower keys win: the branch factor, then the policy's tie break, then board order with cells before units
+    std::uint64_t best_key = ~std::uint64_t{ 0 };
+    std::variant<cell_action, unit_action> best = cell_action{ -1 };
+
+    auto tie_break = [&](bool is_unit, int degree, std::uint32_t order) -> std::uint32_t {
+        switch (policy) {
+        case branch_policy::degree: return 80 - degree;
+        case branch_policy::prefer_unit: return is_unit ? 0 : 1;
+        case branch_policy::random: {
+            std::uint32_t h = (seed ^ order) * 0x9e3779b1u;
+            return (h ^ h >> 15) & 0xffff;
+        }
+        default: return 0;
+        }
+    };
+    auto consider = [&](int branch_factor, std::uint32_t tie, std::uint32_t order, std::variant<cell_action, unit_action> action) {
+        std::uint64_t key = std::uint64_t(branch_factor) << 48 | std::uint64_t(tie) << 16 | order;
+        if (key < best_key) {
+            best_key = key;
+            best = action;
+        }
+    };
+
+    if (policy == branch_policy::mrv || policy == branch_policy::prefer_unit) {
+        //board order decides among the cells, which is the first cell the kernel finds
+        const auto min_cell = kernels::min_candidate_cell(s.grid_, s.annotations_);
+        if (min_cell.cell_idx >= 0) {
+            //nothing beats a two way cell when cells come first
+            if (policy == branch_policy::mrv && min_cell.count == 2) {
+                return cell_action{ min_cell.cell_idx };
+            }
+            consider(min_cell.count, tie_break(false, 0, min_cell.cell_idx), min_cell.cell_idx, cell_action{ min_cell.cell_idx });
+        }
+    }
+    else {
+        for (int i = 0; i < 81; ++i) {
+            int count = std::popcount(s.annotations_[i]);
+            if (s.grid_[i] != 0 || count < 2) {
+                continue;
+            }
+
+            int degree = 0;
+            if (policy == branch_policy::degree) {
+                for (int peer : s.tables_->peers(i)) {
+                    degree += s.grid_[peer] == 0;
+                }
+            }
+            consider(count, tie_break(false, degree, i), i, cell_action{ i });
+        }
+    }
+
+    //only the digits a unit has to hold can be branched on, every one for 9 cells
+    const auto& units = s.tables_->units();
+    for (int unit_idx = 0; unit_idx < static_cast<int> (units.size()); ++unit_idx) {
+        const std::uint16_t required = s.required_digits(unit_idx);
+        if (!required) {
+            continue;
+        }
+
+        {
+            const auto& u = units[unit_idx];
+            //bit sliced counters, bit n of count_bits[k] is bit k of the number of open cells taking digit n + 1
+            std::array<unsigned, 4> count_bits{};
+            int open = 0;
+            for (int idx : std::span(u.cells).first(u.size)) {
+                if (s.grid_[idx] != 0) {
+                    continue;
+                }
+                ++open;
+                unsigned carry = s.annotations_[idx];
+                for (auto& b : count_bits) {
+                    unsigned next = b & carry;
+                    b ^= carry;
+                    carry = next;
+                }
+            }
+
+            //only the fewest places in this unit can compete
+            for (int count = 2; count < 9 && (best_key >> 48) >= static_cast<std::uint64_t> (count); ++count) {
+                unsigned digits = required;
+                for (int k = 0; k < 4; ++k) {
+                    digits &= (count >> k & 1) ? count_bits[k] : ~count_bits[k];
+                }
+                for (; digits; digits &= digits - 1) {
+                    int n = std::countr_zero(digits);
+                    std::uint32_t order = 81 + 9 * unit_idx + n;
+                    consider(count, tie_break(true, open - 1, order), order, unit_action{ u.type, unit_idx, n + 1 });
+                    if (policy != branch_policy::random) {
+                        break;
+                    }
+                }
+                if (digits) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (best_key == ~std::uint64_t{ 0 }) {
+        return std::nullopt;
+    }
+    return best;
+}
+
+std::uint16_t sudoku::choices(const sudoku& s, cell_action ca) {
+    return s.grid_[ca.cell_idx] == 0 ? s.annotations_[ca.cell_idx] : 0;
+}
+
+std::uint16_t sudoku::choices(const sudoku& s, unit_action ua) {
+    std::uint16_t cells = 0;
+    const auto& u = s.tables_->units()[ua.unit_idx];
+    const auto& idxs = u.cells;
+    for (int i = 0; i < u.size; ++i) {
+        if ((s.annotations_[idxs[i]] & 1 << (ua.action - 1)) && s.grid_[idxs[i]] == 0) {
+            cells |= 1 << i;
+        }
+    }
+    return cells;
+}
+
+bool sudoku::choose(cell_action ca, int choice) {
+    stats::add(&solve_stats::branches);
+    if (!place(ca.cell_idx, choice + 1) || annotate_subsets() == step_result::contradiction) {
+        stats::add(&solve_stats::backtracks);
+        return false;
+    }
+    return true;
+}
+
+bool sudoku::choose(unit_action ua, int choice) {
+    stats::add(&solve_stats::branches);
+    if (!place(tables_->units()[ua.unit_idx].cells[choice], ua.action) || annotate_subsets() == step_result::contradiction) {
+        stats::add(&solve_stats::backtracks);
+        return false;
+    }
+    return true;
+}
+
+void sudoku::branch(const sudoku& s, cell_action ca, std::vector<sudoku>& out) {
+    for (unsigned bits = choices(s, ca); bits; bits &= bits - 1) {
+        if (!out.emplace_back(s).choose(ca, std::countr_zero(bits))) {
+            out.pop_back();
+        }
+    }
+}
+
+void sudoku::branch(const sudoku& s, unit_action ua, std::vector<sudoku>& out) {
+    for (unsigned bits = choices(s, ua); bits; bits &= bits - 1) {
+        if (!out.emplace_back(s).choose(ua, std::countr_zero(bits))) {
+            out.pop_back();
+        }
+    }
+}
+
+std::vector<sudoku> sudoku::branch(const sudoku& s, cell_action ca) {
+    std::vector<sudoku> branches;
+    branch(s, ca, branches);
+    return branches;
+}
+
+std::vector<sudoku> sudoku::branch(const sudoku& s, unit_action ua) {
+    std::vector<sudoku> branches;
+    branch(s, ua, branches);
+    return branches;
+}
+
+namespace {
+
+    // in the order of the puzzles in load_sudoku
+    constexpr std::array curated_difficulties = {
+        difficulty::easy, difficulty::easy, difficulty::easy, difficulty::easy,
+        difficulty::medium, difficulty::hard, difficulty::expert, difficulty::expert,
+        difficulty::evil, difficulty::evil, difficulty::evil, difficulty::evil, difficulty::evil,
+        difficulty::evil, difficulty::evil, difficulty::evil, difficulty::evil,
+        difficulty::hard, difficulty::evil,
+        difficulty::expert, difficulty::expert, difficulty::partial,
+        difficulty::evil, difficulty::evil
+    };
+}
+
+sudoku load_sudoku(int puzzle_choice) {
+    //std::fill(grid_.begin(), grid_.end(), 1);
+
+    using namespace std::string_view_literals;
+
+    constexpr std::array puzzles = {
+        //easy from sudoku.com
+                                         " 94   6  "
+                                         " 53986 41"
+                                         " 82 13975"
+                                         "   16 3 7"
+                                         "9    2   "
+                                         " 3     12"
+                                         "56  41   "
+                                         " 1    7  "
+                                         "3  29  5 "sv,
+
+                                         "   7  218"
+                                         "751  249 "
+                                         "    96753"
+                                         " 1 3 8  2"
+                                         " 6     85"
+                                         "8295   7 "
+                                         "1   5  49"
+                                         " 76  45  "
+                                         "   6 38  "sv,
+
+                                         " 2 5 6 1 "
+                                         "6 3179   "
+                                         " 1 3     "
+                                         "  1  234 "
+                                         "349 1  26"
+                                         "2 64 78  "
+                                         "   658   "
+                                         "5 8743 6 "
+                                         "76   1   "sv,
+
+
+        // march 11 from sudoku.com (seemed easy)
+                                        " 8 25  9 "
+                                        " 5 613872"
+                                        "   9 4 1 "
+                                        "5 7    6 "
+                                        "9     2 1"
+                                        "  4      "
+                                        "1  37 9  "
+                                        "  8   34 "
+                                        "67       "sv,
+
+        // medium from sudoku.com
+                                         "  2  7 96"
+                                         "7 5 9  18"
+                                         "1    47  "
+                                         "  97  1 5"
+                                         "    28   "
+                                         "     5 62"
+                                         "   672  1"
+                                         "   8   4 "
+                                         "  3 4  2 "sv,
+
+
+        // hard from sudoku.com*
+                                         "9 4   3 1"
+                                         "  78314  "
+                                         "     928 "
+                                         "3        "
+                                         "4  7  8  "
+                                         " 6 92    "
+                                         "  2 579  "
+                                         "  5    2 "
+                                         "   28  7 "sv,
+
+        // expert from sudoku.com* 
+                                         "    5   9"
+                                         "4    6  1"
+                                         "  1  3 5 "
+                                         "     84  "
+                                         "  7      "
+                                         " 2 19  8 "
+                                         "  9    3 "
+                                         "6   34   "
+                                         "3     7  "sv,
+
+
+                                         "  52 6   "
+                                         "  8   1  "
+                                         "4      6 "
+                                         "    7    "
+                                         " 1  9  8 "
+                                         "79   4   "
+                                         "   45   8"
+                                         "      719"
+                                         "   3    4"sv,
+
+        // evil from sudoku.com*
+                                         " 9       "
+                                         "   7   8 "
+                                         " 54 3 7  "
+                                         "6        "
+                                         "     1  2"
+                                         " 73 5 8  "
+                                         "9     4  "
+                                         "8   6    "
+                                         " 46  5 1 "sv,
+
+        // evil from sudoku.com*
+                                         "      9  "
+                                         " 7   843 "
+                                         "8  6     "
+                                         "  2 1    "
+                                         " 4   687 "
+                                         "        5"
+                                         "  42  35 "
+                                         " 5      6"
+                                         "     3  9"sv,
+
+        // evil from sudoku.com*
+                                         "    5    "
+                                         "1  92   6"
+                                         " 6     7 "
+                                         "  4   8  "
+                                         "     3   "
+                                         "2  16   7"
+                                         "  239  4 "
+                                         "     5  9"
+                                         "3    7   "sv,
+
+        // evil from sudoku.com*
+                                          "  3      "
+                                          "64  1 7  "
+                                          "   5    8"
+                                          "  2 9    "
+                                          "  1   3  "
+                                          "93   8  7"
+                                          "79  6 4  "
+                                          "     1 6 "
+                                          "2        "sv,
+
+        // evil from sudoku.com*
+                                          "    1    "
+                                          "  256 4  "
+                                          " 3      2"
+                                          "7      9 "
+                                          "     8   "
+                                          "  342 6  "
+                                          " 9 85  6 "
+                                          "  5  1   "
+                                          "     38  "sv,
+
+        // evil from sudoku.com*
+                                          " 1     2 "
+                                          "     9   "
+                                          "4  75 6  "
+                                          "  293  6 "
+                                          "     49  "
+                                          "3    8   "
+                                          "  4     5"
+                                          "5  36 7  "
+                                          "    8    "sv,
+
+        // evil from sudoku.com*
+                                           "7 2  5 8 "
+                                           "  1      "
+                                           "    8 6  "
+                                           " 4       "
+                                           "   3    9"
+                                           "5 8  2 6 "
+                                           " 1     7 "
+                                           "4 72  3  "
+                                           " 6   4   "sv,
+
+        // evil from sudoku.com
+                                           "8 47  1  "
+                                           " 6       "
+                                           "    2   9"
+                                           "     8 1 "
+                                           "7 54  8  "
+                                           "3        "
+                                           " 1 6     "
+                                           "5 6 7  2 "
+                                           " 3    5  "sv,
+
+        // evil from sudoku.com*
+                                           "    6    "
+                                           "  8   3  "
+                                           "5  1 7  9"
+                                           "   4     "
+                                           "1  9 2  7"
+                                           " 5     1 "
+                                           " 3 2 69  "
+                                           "    5   6"
+                                           "2   4    "sv,
+
+        // partial puzzle, unrated. grades hard
+                                             " 752 6  3"
+                                             "  894 17 "
+                                             "4  7   6 "
+                                             "    7    "
+                                             " 1  9  87"
+                                             "79   4   "
+                                             "   45   8"
+                                             "      719"
+                                             "   3    4"sv,
+
+        // evil from sudoku.com*
+                                             "4 3 2 9  "
+                                             "  6      "
+                                             "   1   2 "
+                                             " 6  4    "
+                                             " 1    5  "
+                                             "5 48    3"
+                                             " 5       "
+                                             "     7  8"
+                                             "9 2 1 3  "sv,
+
+        // expert sudoku.com*
+                                             " 7    6 8"
+                                             "1 2      "
+                                             " 3 7     "
+                                             "   42   6"
+                                             "     5 2 "
+                                             "      17 "
+                                             "3 5      "
+                                             "   2564  "
+                                             "7    9 1 "sv,
+
+        // expert sudoku.com
+                                             "6      4 "
+                                             "2  35    "
+                                             "  1   5  "
+                                             "   9    1"
+                                             "      478"
+                                             "   1 2  6"
+                                             "     7   "
+                                             " 4   86  "
+                                             " 87 1    "sv,
+
+        // expert sudoku.com, its last row came without givens so it has many solutions
+                                             "1      49"
+                                             "       7 "
+                                             "396 5    "
+                                             "6  9     "
+                                             "    7    "
+                                             " 49  182 "
+                                             "4   87   "
+                                             "  3  2  5"
+                                             "         "sv,
+
+        // evil sudoku.com
+                                             " 2 49   6"
+                                             "     3   "
+                                             "7     5  "
+                                             " 9 16   4"
+                                             "  2    9 "
+                                             "    8    "
+                                             "     2  3"
+                                             " 1   8   "
+                                             "  531 6  "sv,
+
+        // evil sudoku.com
+                                             "  5    2 "
+                                             "9  4  1 5"
+                                             "    1  7 "
+                                             "       1 "
+                                             " 8 9     "
+                                             "  7 4 6 3"
+                                             "  3 6 5 4"
+                                             "        2"
+                                             "7    3   "sv
+    };
+
+    static_assert(puzzles.size() == curated_difficulties.size());
+
+    const auto& puzzle = puzzles[(puzzle_choice + puzzles.size()) % puzzles.size()];
+    return parse_sudoku(puzzle);
+}
+
+int num_curated_sudokus() {
+    return static_cast<int> (curated_difficulties.size());
+}
+
+difficulty curated_difficulty(int puzzle_choice) {
+    const int n = num_curated_sudokus();
+    return curated_difficulties[((puzzle_choice % n) + n) % n];
+}
+
+std::string_view to_string(difficulty d) {
+    switch (d) {
+    case difficulty::easy: return "easy";
+    case difficulty::medium: return "medium";
+    case difficulty::hard: return "hard";
+    case difficulty::expert: return "expert";
+    case difficulty::evil: return "evil";
+    case difficulty::partial: return "partial";
+    }
+    return "unknown";
+}
+
+difficulty parse_difficulty(std::string_view name) {
+    for (auto d : { difficulty::easy, difficulty::medium, difficulty::hard, difficulty::expert, difficulty::evil }) {
+        if (name == to_string(d)) {
+            return d;
+        }
+    }
+    throw std::invalid_argument("unknown difficulty: " + std::string(name));
+}
+
+std::string_view to_string(branch_policy p) {
+    switch (p) {
+    case branch_policy::mrv: return "mrv";
+    case branch_policy::degree: return "degree";
+    case branch_policy::prefer_unit: return "prefer-unit";
+    case branch_policy::random: return "random";
+    }
+    return "unknown";
+}
+
+branch_policy parse_branch_policy(std::string_view name) {
+    for (auto p : { branch_policy::mrv, branch_policy::degree, branch_policy::prefer_unit, branch_policy::random }) {
+        if (name == to_string(p)) {
+            return p;
+        }
+    }
+    throw std::invalid_argument("unknown branch policy: " + std::string(name));
+}
+
+sudoku parse_sudoku(std::string_view line) {
+    std::array<std::uint8_t, 9 * 9> digits{};
+    int bad = line.size() >= digits.size() ? kernels::parse_line(line.data(), digits) : -1;
+
+    if (line.size() < digits.size()) {
+        //report the first bad character before the missing cells
+        std::array<char, 9 * 9> padded;
+        padded.fill('.');
+        std::copy(line.begin(), line.end(), padded.begin());
+        bad = kernels::parse_line(padded.data(), digits);
+        if (bad < 0) {
+            throw parse_error("line ends after " + std::to_string(line.size()) + " of 81 cells", line.size());
+        }
+    }
+
+    if (bad >= 0) {
+        throw parse_error("unexpected character '" + std::string(1, line[bad]) + "' at column " + std::to_string(bad + 1), bad);
+    }
+    if (line.size() > digits.size()) {
+        throw parse_error("unexpected character '" + std::string(1, line[81]) + "' after 81 cells", 81);
+    }
+
+    std::array<int, 9 * 9> grid;
+    std::copy(digits.begin(), digits.end(), grid.begin());
+    return sudoku{ grid };
+}
+
+std::string to_string(const sudoku& s) {
+    std::string line(81, '.');
+    std::transform(s.grid().begin(), s.grid().end(), line.begin(), [](int cell) {
+        return cell ? static_cast<char>('0' + cell) : '.';
+        });
+    return line;
+}
+
+std::vector<sudoku> branch_minimal(const sudoku& s) {
+    std::vector<sudoku> branches;
+
+    //branch on the action with the fewest alternatives
+    if (auto action_choice = sudoku::get_minimal_action(s)) {
+        std::visit([&](const auto& action) {
+            sudoku::branch(s, action, branches);
+            }, *action_choice);
+    }
+
+    return branches;
+}
+
+namespace {
+    // one context per thread, its stack is reused by every puzzle the thread solves
+    solver_context& thread_context() {
+        thread_local solver_context context;
+        return context;
+    }
+}
+
+sudoku solve(const sudoku& s) {
+    return thread_context().solve(s);
+}
+
+int count_solutions(const sudoku& s, int limit) {
+    return thread_context().count_solutions(s, limit);
+}
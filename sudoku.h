@@ -0,0 +1,242 @@
+﻿// sudoku.h : The sudoku state and solving operations shared by the
+// application and the headless solver.
+
+#pragma once
+
+#include <array>
+#include <optional>
+#include <span>
+#include <cstdint>
+#include <vector>
+#include <variant>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+class sudoku;
+class sudoku_render;
+class variant_tables;
+
+// the rows, columns and boxes of plain sudoku, see variant_tables
+const variant_tables& classic_tables();
+
+struct cell_action {
+    int cell_idx;
+};
+
+enum class unit {
+    row,
+    column,
+    box,
+    diagonal,
+    disjoint_group,
+    cage,
+};
+
+// unit_idx is the unit's index in the tables of the state it was taken from, see variant_tables
+struct unit_action {
+    unit type;
+    int unit_idx;
+    int action;
+};
+
+// what a propagation step did to the state
+enum class step_result {
+    changed,
+    stuck,
+    contradiction,
+};
+
+// the propagation techniques of sudoku::step, cheapest first
+enum class technique {
+    naked_singles,
+    hidden_singles,
+    subsets,
+};
+
+// how sudoku::select_action breaks ties between the actions with the fewest branches
+enum class branch_policy {
+    mrv,            //cells before units, then board order. what get_minimal_action picks
+    degree,         //the action constraining the most open cells: a cell's open peers, a unit's other open cells
+    prefer_unit,    //units before cells, then board order
+    random          //uniformly among the ties, driven by the caller's seed
+};
+
+// a puzzle line that could not be read, position is the offset of the offending character
+class parse_error : public std::runtime_error {
+
+    std::size_t position_;
+
+public:
+
+    parse_error(const std::string& what, std::size_t position) : std::runtime_error(what), position_(position) {}
+
+    std::size_t position() const { return position_; }
+};
+
+// an undo log of the cells a sudoku changed while attached to it, 4 bytes for every cell change. along one
+// path of a search every change removes a candidate or places a digit, so it never needs more than max_entries
+class sudoku_trail {
+public:
+
+    // what a cell held before the change
+    struct entry {
+        std::uint8_t idx;
+        std::uint8_t digit;
+        std::uint16_t annotation;
+    };
+
+    static constexpr std::size_t max_entries = 81 * 10;
+
+private:
+
+    friend class sudoku;
+
+    std::vector<entry> entries_;
+
+public:
+
+    sudoku_trail() { entries_.reserve(max_entries); }
+
+    std::size_t mark() const { return entries_.size(); }
+    std::span<const entry> since(std::size_t mark) const { return std::span(entries_).subspan(mark); }
+    void clear() { entries_.clear(); }
+};
+
+class sudoku {
+
+    friend class sudoku_render;
+
+    // copies start out without a trail, only the state it was attached to writes into it
+    struct trail_ref {
+        sudoku_trail* trail{ nullptr };
+
+        trail_ref() = default;
+        trail_ref(const trail_ref&) {}
+        trail_ref& operator=(const trail_ref&) { return *this; }
+    };
+
+    // grid_ holds the placed digit 1-9 of every cell, 0 when open. annotations_ holds 9 bit candidate masks,
+    // bit n set for digit n + 1, a filled cell keeps only the bit of its digit
+    std::array<std::uint8_t, 9 * 9> grid_{};
+    std::array<std::uint16_t, 9 * 9> annotations_{};
+    std::uint8_t open_cells_{ 81 };
+    bool valid_{ true };    //whether the givens agree, placements only ever take candidates after that
+    const variant_tables* tables_;
+    trail_ref trail_;
+
+private: 
+
+    void record(int idx) {
+        if (trail_.trail) {
+            trail_.trail->entries_.push_back({ static_cast<std::uint8_t> (idx), grid_[idx], annotations_[idx] });
+        }
+    }
+    void restore(const sudoku_trail::entry& e);
+
+    void assign(int idx, int digit);
+    // false as soon as a peer runs out of candidates, the state is left half propagated
+    bool place(int idx, int digit);
+
+    void load_annotate();
+
+    // the digits a summed cage can still take in its open cells and the ones it must, false when no digit set
+    // adding up to its sum fits anymore
+    bool cage_digits(int unit_idx, std::uint16_t& allowed, std::uint16_t& required) const;
+
+    // the digits of a unit that need a place in it, every digit for 9 cells
+    std::uint16_t required_digits(int unit_idx) const;
+    bool sums_hold() const;
+
+    // the techniques report whether they placed or eliminated anything, and stop at the first cell without
+    // candidates or digit without a place in a unit
+    step_result solve_naked_singles();
+    step_result solve_hidden_singles();
+    step_result annotate_subsets();
+
+public:
+
+    // givens that clash leave a state whose every step is a contradiction. tables has to outlive the state
+    // and every copy of it
+    sudoku(std::array<int, 9 * 9> grid, const variant_tables& tables = classic_tables());
+    sudoku(const sudoku& o) = default;
+
+    const std::array<std::uint8_t, 9 * 9>& grid() const { return grid_; }
+    const variant_tables& tables() const { return *tables_; }
+
+    // every change from here on is logged to trail until attached to another one or nullptr
+    void attach(sudoku_trail* trail) { trail_.trail = trail; }
+
+    // takes back the changes logged after mark and drops them from the trail
+    void unwind(std::size_t mark);
+
+    // takes back the changes in entries, newest first. they are logged again when a trail is attached, as
+    // changes of their own
+    void undo(std::span<const sudoku_trail::entry> entries);
+
+    // one pass of every technique in place, stuck when none of them placed or eliminated anything
+    step_result step();
+
+    // the same with only the techniques up to and including up_to, for grading how hard a puzzle is
+    step_result step(technique up_to);
+
+    // steps until the state is stuck or every cell is filled, changed when any step made progress
+    step_result advance();
+    bool is_solved() const;
+
+    // whether no cell holds the same digit as one of its peers, a full check of the grid
+    static bool validate(const sudoku& s);
+    static std::vector<cell_action> get_minimal_cell_actions(const sudoku& s, int branch_factor);
+    static std::vector<unit_action> get_minimal_unit_actions(const sudoku& s, int branch_factor);
+    static std::vector<std::variant<cell_action, unit_action>> get_minimal_actions(const sudoku& s, int branch_factor);
+    static std::optional<std::variant<cell_action, unit_action>> get_minimal_action(const sudoku& s);
+
+    // scores every cell and unit action in one pass and returns the best, nothing when no open cell or
+    // unit digit has between 2 and 8 choices
+    static std::optional<std::variant<cell_action, unit_action>> select_action(const sudoku& s, branch_policy policy, std::uint32_t seed = 0);
+    static std::vector<sudoku> branch(const sudoku& s, cell_action ca);
+    static std::vector<sudoku> branch(const sudoku& s, unit_action ca);
+
+    // the alternatives an action branches into, bit n for the nth digit of a cell or the nth cell of a unit
+    static std::uint16_t choices(const sudoku& s, cell_action ca);
+    static std::uint16_t choices(const sudoku& s, unit_action ua);
+
+    // takes one of the choices in place, false when the state contradicts itself
+    bool choose(cell_action ca, int choice);
+    bool choose(unit_action ua, int choice);
+
+    // append the branches to out, nothing is allocated while out has capacity left
+    static void branch(const sudoku& s, cell_action ca, std::vector<sudoku>& out);
+    static void branch(const sudoku& s, unit_action ua, std::vector<sudoku>& out);
+};
+
+// one of the curated puzzles, wrapping around in both directions
+sudoku load_sudoku(int puzzle_choice = -1);
+
+// the rating a curated puzzle came with, partial puzzles have several solutions
+enum class difficulty { easy, medium, hard, expert, evil, partial };
+
+int num_curated_sudokus();
+difficulty curated_difficulty(int puzzle_choice);
+std::string_view to_string(difficulty d);
+
+// "easy", "medium", "hard", "expert" or "evil", throws std::invalid_argument for anything else
+difficulty parse_difficulty(std::string_view name);
+
+// "mrv", "degree", "prefer-unit" or "random", parse_branch_policy throws std::invalid_argument for anything else
+std::string_view to_string(branch_policy p);
+branch_policy parse_branch_policy(std::string_view name);
+
+// exactly 81 characters, '1'-'9' for givens and '.', '0' or ' ' for an empty cell.
+// throws parse_error for anything else
+sudoku parse_sudoku(std::string_view line);
+std::string to_string(const sudoku& s);
+
+// branches on the first action with the lowest branch factor, empty when there is nothing to branch on
+std::vector<sudoku> branch_minimal(const sudoku& s);
+
+// depth first search until a solved state is reached, returns s when there is no solution
+sudoku solve(const sudoku& s);
+
+// number of solutions of s, the search stops once limit are found. 2 tells unique puzzles apart
+int count_solutions(const sudoku& s, int limit = 2);
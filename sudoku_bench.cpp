@@ -0,0 +1,308 @@
+﻿// sudoku_bench.cpp : Benchmarks every engine on sudoku17 and the curated puzzles grouped by difficulty.
+//
+// usage: sudoku_bench [--engine name] [--policy name|all] [--limit n] [--repeat n] [--format text|json|csv] [puzzle_file]
+//   puzzle_file is data/sudoku17.txt by default, --limit takes only its first n puzzles
+//   the curated corpora are tiny, every puzzle in them is solved --repeat times (200 by default)
+//   reports throughput, p50/p99/max latency per solve and heap allocations per solve.
+//   json and csv keep their field names stable so results can be compared across releases
+
+#include "sudoku.h"
+#include "solver_engine.h"
+#include "mapped_file.h"
+#include "puzzle_format.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+    // counts every heap allocation in the process, solves are timed on one thread so the difference
+    // across a solve belongs to it
+    std::atomic<long long> num_allocations{ 0 };
+
+    // a whole decimal number no smaller than min, nothing for anything else
+    template <typename T>
+    std::optional<T> parse_number(std::string_view arg, T min) {
+        T value{};
+        auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+        if (error != std::errc{} || end != arg.data() + arg.size() || value < min) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    struct corpus {
+        std::string name;
+        std::vector<sudoku> puzzles;
+        int repeat{ 1 };
+    };
+
+    struct bench_result {
+        std::string engine;
+        std::string corpus;
+        long long solves{ 0 };
+        long long solved{ 0 };
+        double seconds{ 0.0 };
+        double p50_us{ 0.0 };
+        double p99_us{ 0.0 };
+        double max_us{ 0.0 };
+        double allocations_per_solve{ 0.0 };
+
+        double solves_per_second() const { return seconds > 0.0 ? solves / seconds : 0.0; }
+    };
+
+    std::vector<corpus> load_corpora(const std::string& path, long long limit, int repeat) {
+        std::vector<corpus> corpora;
+
+        mapped_file file(path);
+        corpus file_corpus{ path.substr(path.find_last_of("/\\") + 1), {}, 1 };
+        if (puzzle_format::is_binary(file.text())) {
+            puzzle_reader reader(file.text());
+            std::size_t count = limit >= 0 ? std::min<std::size_t>(reader.size(), limit) : reader.size();
+            file_corpus.puzzles.assign(count, sudoku{ {} });
+            reader.read(0, file_corpus.puzzles);
+        }
+        else {
+            std::size_t pos = 0;
+            for (auto line = puzzle_format::next_puzzle_line(file.text(), pos); !line.empty(); line = puzzle_format::next_puzzle_line(file.text(), pos)) {
+                if (limit >= 0 && static_cast<long long> (file_corpus.puzzles.size()) >= limit) {
+                    break;
+                }
+                file_corpus.puzzles.push_back(parse_sudoku(line));
+            }
+        }
+        corpora.push_back(std::move(file_corpus));
+
+        for (auto d : { difficulty::easy, difficulty::medium, difficulty::hard, difficulty::expert, difficulty::evil }) {
+            corpus curated{ "curated-" + std::string(to_string(d)), {}, repeat };
+            for (int i = 0; i < num_curated_sudokus(); ++i) {
+                if (curated_difficulty(i) == d) {
+                    curated.puzzles.push_back(load_sudoku(i));
+                }
+            }
+            if (!curated.puzzles.empty()) {
+                corpora.push_back(std::move(curated));
+            }
+        }
+        return corpora;
+    }
+
+    bench_result run(solver_engine& engine, std::string label, const corpus& c) {
+        using clock = std::chrono::steady_clock;
+        using double_us = std::chrono::duration<double, std::micro>;
+
+        std::vector<double> latencies;
+        latencies.reserve(c.puzzles.size() * c.repeat);
+
+        //one untimed solve so lazily built state does not land on the first puzzle
+        if (!c.puzzles.empty()) {
+            engine.solve(c.puzzles.front());
+        }
+
+        bench_result result{ std::move(label), c.name };
+        long long allocations = 0;
+        for (int r = 0; r < c.repeat; ++r) {
+            for (const auto& puzzle : c.puzzles) {
+                long long allocations_before = num_allocations.load(std::memory_order_relaxed);
+                auto start = clock::now();
+                auto solution = engine.solve(puzzle);
+                auto end = clock::now();
+                allocations += num_allocations.load(std::memory_order_relaxed) - allocations_before;
+
+                latencies.push_back(std::chrono::duration_cast<double_us> (end - start).count());
+                result.solved += solution.is_solved();
+            }
+        }
+
+        result.solves = static_cast<long long> (latencies.size());
+        if (latencies.empty()) {
+            return result;
+        }
+
+        for (double l : latencies) {
+            result.seconds += l / 1e6;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies[static_cast<std::size_t> (p * (latencies.size() - 1))];
+        };
+        result.p50_us = percentile(0.50);
+        result.p99_us = percentile(0.99);
+        result.max_us = latencies.back();
+        result.allocations_per_solve = static_cast<double> (allocations) / result.solves;
+        return result;
+    }
+
+    void print_text(std::ostream& os, const std::vector<bench_result>& results) {
+        os << "kernels: " << kernels::active_isa() << "\n";
+        os << std::left << std::setw(18) << "engine" << std::setw(18) << "corpus" << std::right
+           << std::setw(9) << "solves" << std::setw(9) << "solved" << std::setw(13) << "solves/s"
+           << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "max us"
+           << std::setw(14) << "allocs/solve" << "\n";
+
+        os << std::fixed;
+        for (const auto& r : results) {
+            os << std::left << std::setw(18) << r.engine << std::setw(18) << r.corpus << std::right
+               << std::setw(9) << r.solves << std::setw(9) << r.solved
+               << std::setw(13) << std::setprecision(0) << r.solves_per_second()
+               << std::setw(11) << std::setprecision(1) << r.p50_us
+               << std::setw(11) << r.p99_us << std::setw(11) << r.max_us
+               << std::setw(14) << std::setprecision(2) << r.allocations_per_solve << "\n";
+        }
+    }
+
+    void print_json(std::ostream& os, const std::vector<bench_result>& results) {
+        os << "{\"kernels\":\"" << kernels::active_isa() << "\",\"results\":[";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            os << (i ? "," : "") << "\n  {\"engine\":\"" << r.engine << "\",\"corpus\":\"" << r.corpus
+               << "\",\"solves\":" << r.solves << ",\"solved\":" << r.solved << ",\"seconds\":" << r.seconds
+               << ",\"solves_per_second\":" << r.solves_per_second() << ",\"p50_us\":" << r.p50_us
+               << ",\"p99_us\":" << r.p99_us << ",\"max_us\":" << r.max_us
+               << ",\"allocations_per_solve\":" << r.allocations_per_solve << "}";
+        }
+        os << "\n]}\n";
+    }
+
+    void print_csv(std::ostream& os, const std::vector<bench_result>& results) {
+        os << "kernels,engine,corpus,solves,solved,seconds,solves_per_second,p50_us,p99_us,max_us,allocations_per_solve\n";
+        for (const auto& r : results) {
+            os << kernels::active_isa() << "," << r.engine << "," << r.corpus << "," << r.solves << "," << r.solved << ","
+               << r.seconds << "," << r.solves_per_second() << "," << r.p50_us << "," << r.p99_us << ","
+               << r.max_us << "," << r.allocations_per_solve << "\n";
+        }
+    }
+}
+
+void* operator new(std::size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// over-aligned types come through here, aligned_alloc wants a multiple of the alignment
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    const auto align = static_cast<std::size_t> (alignment);
+    if (void* p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path = "data/sudoku17.txt";
+    std::vector<std::string_view> engines = engine_names();
+    std::string_view policy_name = "mrv";
+    std::string_view format = "text";
+    long long limit = -1;
+    int repeat = 200;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc) {
+            engines = { argv[++i] };
+        }
+        else if (arg == "--policy" && i + 1 < argc) {
+            policy_name = argv[++i];
+        }
+        else if (arg == "--limit" && i + 1 < argc) {
+            auto n = parse_number(std::string_view(argv[++i]), 0LL);
+            if (!n) {
+                std::cerr << "--limit expects a number of puzzles, got " << argv[i] << "\n";
+                return 2;
+            }
+            limit = *n;
+        }
+        else if (arg == "--repeat" && i + 1 < argc) {
+            auto n = parse_number(std::string_view(argv[++i]), 1);
+            if (!n) {
+                std::cerr << "--repeat expects a positive count, got " << argv[i] << "\n";
+                return 2;
+            }
+            repeat = *n;
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        }
+        else {
+            path = arg;
+        }
+    }
+
+    if (format != "text" && format != "json" && format != "csv") {
+        std::cerr << "unknown format " << format << ", expected text, json or csv\n";
+        return 2;
+    }
+
+    std::vector<bench_result> results;
+    try {
+        auto policies = policy_name == "all"
+            ? std::vector{ branch_policy::mrv, branch_policy::degree, branch_policy::prefer_unit, branch_policy::random }
+            : std::vector{ parse_branch_policy(policy_name) };
+        auto corpora = load_corpora(path, limit, repeat);
+        for (auto name : engines) {
+            for (auto policy : policies) {
+                //only the rules engine branches by policy, dlx always covers the column with the fewest rows
+                if (name != "rules" && policy != policies.front()) {
+                    continue;
+                }
+                auto engine = make_engine(name, policy);
+
+                std::string label(engine->name());
+                if (name == "rules" && policy != branch_policy::mrv) {
+                    label += "/" + std::string(to_string(policy));
+                }
+                for (const auto& c : corpora) {
+                    results.push_back(run(*engine, label, c));
+                    std::cerr << label << " " << c.name << " done\n";
+                }
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+
+    if (format == "json") {
+        print_json(std::cout, results);
+    }
+    else if (format == "csv") {
+        print_csv(std::cout, results);
+    }
+    else {
+        print_text(std::cout, results);
+    }
+    return 0;
+}
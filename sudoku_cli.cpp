@@ -0,0 +1,609 @@
+﻿// sudoku_cli.cpp : Headless solver, reads one puzzle per line and writes one solution per line.
+//
+// usage: sudoku_cli [-j threads] [--engine rules|dlx] [--policy mrv|degree|prefer-unit|random]
+//                   [--no-lockstep] [--parallel-search] [--stats]
+//                   [--binary-output solution_file] [puzzle_file]
+//        sudoku_cli [-j threads] [--engine rules|dlx] --count limit [puzzle_file]
+//        sudoku_cli --convert output_file puzzle_file
+//        sudoku_cli [-j threads] [--engine rules|dlx] --serve | --listen socket_path
+//        sudoku_cli --box 2x2|2x3|3x3|3x4|4x4|5x5 [--count limit] [puzzle_file]
+//        sudoku_cli [-j threads] [--policy mrv|degree|prefer-unit|random] [--stats]
+//                   --variant x,disjoint,anti-knight,killer [--count limit] [puzzle_file]
+//   reads from stdin when no file (or "-") is given
+//   a puzzle file, text or binary (see puzzle_format.h), is memory mapped and solved in parallel chunks as
+//   it is decoded, with one worker per core by default. on stdin -j 1 solves each line as it is read,
+//   otherwise the puzzles are solved in parallel
+//   --binary-output writes the solutions of a puzzle file in the binary format instead of to stdout
+//   --count writes the number of solutions of each puzzle instead, searching no further than limit of them
+//   ("2+" with a limit of 2). it exits with 1 unless every puzzle has exactly one solution
+//   --convert turns a text puzzle file into a binary one or a binary one back into text
+//   --serve answers puzzle lines from stdin as they arrive, one line each in input order, until stdin ends.
+//   --listen does the same for every connection to a Unix socket, see solve_server.h
+//   --box solves grids with boxes of that many rows and columns one line at a time, digits past 9 written
+//   as A-Z (see basic_sudoku.h). 3x3 goes through the same solver as every 9x9 puzzle. every other option is
+//   ignored except --count
+//   --variant solves 9x9 puzzles under extra constraints with the rules engine, killer cages follow the cells
+//   of each line (see parse_variant_puzzle). the puzzles are read first and solved or counted in parallel
+//   --engine picks the solving backend, rules by default
+//   --policy picks how the rules engine chooses what to branch on, mrv by default (see branch_policy)
+//   --no-lockstep hands every puzzle straight to the engine instead of propagating singles for
+//   groups of puzzles together first (parallel mode only)
+//   --parallel-search solves one puzzle at a time, exploring its branches in parallel. it takes neither
+//   another engine, another policy nor --stats
+//   --stats prints the search counters summed over all puzzles to stderr, and per puzzle when -j 1 reads
+//   stdin. they are only counted in builds with SUDOKU_STATS. lockstep places singles outside any engine,
+//   so --stats turns it off and the totals are the same for every -j
+
+#include "sudoku.h"
+#include "batch_solver.h"
+#include "parallel_search.h"
+#include "solver_engine.h"
+#include "mapped_file.h"
+#include "puzzle_format.h"
+#include "solve_server.h"
+#include "basic_sudoku.h"
+#include "variant_sudoku.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+namespace {
+
+    struct batch_options {
+        unsigned num_threads;
+        std::string_view engine;
+        branch_policy policy;
+        bool lockstep;
+        bool show_stats;
+    };
+
+    // a whole decimal number no smaller than min, nothing for anything else
+    std::optional<int> parse_count(std::string_view arg, int min) {
+        int value = 0;
+        auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+        if (error != std::errc{} || end != arg.data() + arg.size() || value < min) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    void print_stats(std::ostream& os, const solve_stats& s) {
+        os << "steps " << s.advance_steps << ", naked singles " << s.naked_singles << ", hidden singles " << s.hidden_singles
+           << ", subset eliminations " << s.subset_eliminations << ", branches " << s.branches
+           << ", backtracks " << s.backtracks << ", max depth " << s.max_depth << "\n";
+    }
+
+    sudoku parse_line(const std::string& line, long long line_number) {
+        try {
+            return parse_sudoku(line);
+        }
+        catch (const parse_error& e) {
+            throw parse_error("line " + std::to_string(line_number) + ": " + e.what(), e.position());
+        }
+    }
+
+    int solve_stream(std::istream& is, std::ostream& os, solver_engine& engine, task_pool* pool, bool show_stats) {
+        using double_s = std::chrono::duration<double>;
+
+        int num_puzzles = 0;
+        int num_solved = 0;
+        solve_stats total_stats;
+
+        auto solver_start = std::chrono::steady_clock::now();
+        std::string line;
+        long long line_number = 0;
+        while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+            auto puzzle = parse_line(line, line_number);
+            auto solution = pool ? solve(puzzle, *pool) : engine.solve(puzzle);
+            num_solved += solution.is_solved();
+            ++num_puzzles;
+
+            if (show_stats && !pool) {
+                total_stats += engine.stats();
+                std::cerr << "line " << line_number << ": ";
+                print_stats(std::cerr, engine.stats());
+            }
+
+            os << to_string(solution) << '\n';
+        }
+        os.flush();
+        auto solver_end = std::chrono::steady_clock::now();
+
+        std::cerr << num_solved << "/" << num_puzzles << " sudokus were solved completely in "
+                  << std::chrono::duration_cast<double_s> (solver_end - solver_start).count() << "s\n";
+        if (show_stats && !pool) {
+            print_stats(std::cerr, total_stats);
+        }
+
+        return num_solved == num_puzzles ? 0 : 1;
+    }
+
+    int solve_parallel(const std::vector<sudoku>& puzzles, std::ostream& os, const batch_options& options) {
+        task_pool pool(options.num_threads);
+        auto result = solve_batch(puzzles, pool, options.engine, options.lockstep, options.policy);
+
+        for (const auto& s : result.solutions) {
+            os << to_string(s) << '\n';
+        }
+        os.flush();
+
+        std::cerr << result.num_solved << "/" << puzzles.size() << " sudokus were solved completely in "
+                  << result.seconds << "s on " << pool.size() << " threads ("
+                  << result.puzzles_per_second() << " puzzles/s)\n";
+        if (options.show_stats) {
+            print_stats(std::cerr, result.total_stats);
+        }
+
+        return result.num_solved == static_cast<int> (puzzles.size()) ? 0 : 1;
+    }
+
+    int solve_file(const mapped_file& file, std::ostream& os, puzzle_writer* writer, const batch_options& options) {
+        task_pool pool(options.num_threads);
+
+        std::string out;
+        const auto emit = [&](std::span<const sudoku> solutions) {
+            if (writer) {
+                for (const auto& s : solutions) {
+                    writer->write(s);
+                }
+                return;
+            }
+
+            out.clear();
+            for (const auto& s : solutions) {
+                out += to_string(s);
+                out += '\n';
+            }
+            os.write(out.data(), static_cast<std::streamsize> (out.size()));
+        };
+
+        auto result = puzzle_format::is_binary(file.text())
+            ? solve_binary(puzzle_reader(file.text()), pool, emit, options.engine, options.lockstep, options.policy)
+            : solve_text(file.text(), pool, emit, options.engine, options.lockstep, options.policy);
+        if (writer) {
+            writer->finish();
+        }
+        os.flush();
+
+        std::cerr << result.num_solved << "/" << result.num_puzzles << " sudokus were solved completely in "
+                  << result.seconds << "s on " << pool.size() << " threads ("
+                  << result.puzzles_per_second() << " puzzles/s)\n";
+        if (options.show_stats) {
+            print_stats(std::cerr, result.total_stats);
+        }
+
+        return result.num_solved == result.num_puzzles ? 0 : 1;
+    }
+
+    // writes the counts count(pool, emit) hands to emit, one line each
+    template <typename Count>
+    int write_counts(std::ostream& os, int limit, const batch_options& options, Count count) {
+        task_pool pool(options.num_threads);
+
+        std::string out;
+        const auto emit = [&](std::span<const int> counts) {
+            out.clear();
+            for (int c : counts) {
+                out += std::to_string(c);
+                if (c == limit) {
+                    out += '+';
+                }
+                out += '\n';
+            }
+            os.write(out.data(), static_cast<std::streamsize> (out.size()));
+        };
+
+        auto result = count(pool, emit);
+        os.flush();
+
+        std::cerr << result.num_unique << "/" << result.num_puzzles << " sudokus have a unique solution, "
+                  << result.num_unsolvable << " have none, counted in " << result.seconds << "s on " << pool.size()
+                  << " threads (" << result.puzzles_per_second() << " puzzles/s)\n";
+        if (options.show_stats) {
+            print_stats(std::cerr, result.total_stats);
+        }
+
+        return result.num_unique == result.num_puzzles ? 0 : 1;
+    }
+
+    int count_puzzles(std::string_view text, std::ostream& os, int limit, const batch_options& options) {
+        return write_counts(os, limit, options, [&](task_pool& pool, const auto& emit) {
+            return puzzle_format::is_binary(text)
+                ? count_binary(puzzle_reader(text), pool, emit, limit, options.engine, options.policy)
+                : count_text(text, pool, emit, limit, options.engine, options.policy);
+        });
+    }
+
+    template <int BoxRows, int BoxColumns>
+    int solve_basic_stream(std::istream& is, std::ostream& os, int count_limit) {
+        using double_s = std::chrono::duration<double>;
+
+        basic_solver<BoxRows, BoxColumns> solver;
+        int num_puzzles = 0;
+        int num_done = 0;
+
+        auto solver_start = std::chrono::steady_clock::now();
+        std::string line;
+        long long line_number = 0;
+        while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+            const auto puzzle = [&]() {
+                try {
+                    return parse_basic_sudoku<BoxRows, BoxColumns>(line);
+                }
+                catch (const parse_error& e) {
+                    throw parse_error("line " + std::to_string(line_number) + ": " + e.what(), e.position());
+                }
+            }();
+            ++num_puzzles;
+
+            if (count_limit > 0) {
+                int count = solver.count_solutions(puzzle, count_limit);
+                num_done += count == 1;
+                os << count << (count == count_limit ? "+\n" : "\n");
+                continue;
+            }
+
+            auto solution = solver.solve(puzzle);
+            num_done += solution.is_solved();
+            os << to_string(solution) << '\n';
+        }
+        os.flush();
+        auto solver_end = std::chrono::steady_clock::now();
+
+        std::cerr << num_done << "/" << num_puzzles << " sudokus " << (count_limit > 0 ? "have a unique solution" : "were solved completely")
+                  << ", done in " << std::chrono::duration_cast<double_s> (solver_end - solver_start).count() << "s\n";
+
+        return num_done == num_puzzles ? 0 : 1;
+    }
+
+    // the box shapes --box accepts, nullptr for anything else
+    using basic_stream_solver = int (*)(std::istream&, std::ostream&, int);
+
+    basic_stream_solver find_basic_solver(std::string_view shape) {
+        if (shape == "2x2") return solve_basic_stream<2, 2>;
+        if (shape == "2x3") return solve_basic_stream<2, 3>;
+        if (shape == "3x3") return solve_basic_stream<3, 3>;
+        if (shape == "3x4") return solve_basic_stream<3, 4>;
+        if (shape == "4x4") return solve_basic_stream<4, 4>;
+        if (shape == "5x5") return solve_basic_stream<5, 5>;
+        return nullptr;
+    }
+
+    // the puzzles of a --variant stream. lines with cages get tables of their own, kept in cage_tables, the others
+    // share the tables of the rules
+    std::vector<sudoku> read_variant_puzzles(std::istream& is, const variant_rules& rules, const variant_tables& shared_tables,
+                                             std::deque<variant_tables>& cage_tables) {
+        std::vector<sudoku> puzzles;
+        std::string line;
+        long long line_number = 0;
+        while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+            variant_rules puzzle_rules = rules;
+            try {
+                auto grid = parse_variant_puzzle(line, puzzle_rules);
+                if (puzzle_rules.cages.size() == rules.cages.size()) {
+                    puzzles.emplace_back(grid, shared_tables);
+                }
+                else {
+                    puzzles.emplace_back(grid, cage_tables.emplace_back(puzzle_rules));
+                }
+            }
+            catch (const parse_error& e) {
+                throw parse_error("line " + std::to_string(line_number) + ": " + e.what(), e.position());
+            }
+            catch (const std::invalid_argument& e) {
+                throw parse_error("line " + std::to_string(line_number) + ": " + e.what(), 81);
+            }
+        }
+        return puzzles;
+    }
+
+    int solve_variant_stream(std::istream& is, std::ostream& os, const variant_rules& rules, int count_limit, const batch_options& options) {
+        const variant_tables shared_tables(rules);
+        std::deque<variant_tables> cage_tables;
+        const auto puzzles = read_variant_puzzles(is, rules, shared_tables, cage_tables);
+
+        if (count_limit > 0) {
+            return write_counts(os, count_limit, options, [&](task_pool& pool, const auto& emit) {
+                return count_batch(puzzles, pool, emit, count_limit, options.engine, options.policy);
+            });
+        }
+        return solve_parallel(puzzles, os, options);
+    }
+
+    int convert_file(const mapped_file& file, const std::string& output_path) {
+        std::ofstream os(output_path, std::ios::binary);
+        if (!os) {
+            std::cerr << "could not open " << output_path << "\n";
+            return 2;
+        }
+
+        bool to_text = puzzle_format::is_binary(file.text());
+        auto count = to_text ? binary_to_text(file.text(), os) : text_to_binary(file.text(), os);
+        os.flush();
+        if (!os) {
+            std::cerr << "could not write " << output_path << "\n";
+            return 2;
+        }
+
+        std::cerr << "converted " << count << " sudokus to " << (to_text ? "text" : "binary") << "\n";
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::ios::sync_with_stdio(false);
+
+    unsigned num_threads = std::thread::hardware_concurrency();
+    bool parallel_search = false;
+    bool lockstep = true;
+    std::string_view engine_name = "rules";
+    std::string_view policy_name = "mrv";
+    std::string_view path = "-";
+    bool has_path = false;
+    std::string_view convert_path;
+    std::string_view binary_output_path;
+    std::string_view listen_path;
+    bool serve = false;
+    bool show_stats = false;
+    int count_limit = 0;
+    std::string_view box_shape;
+    std::string_view variant_names;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            auto threads = parse_count(argv[++i], 1);
+            if (!threads) {
+                std::cerr << "-j expects a positive number of threads, got " << argv[i] << "\n";
+                return 2;
+            }
+            num_threads = static_cast<unsigned> (*threads);
+        }
+        else if (arg == "--engine" && i + 1 < argc) {
+            engine_name = argv[++i];
+        }
+        else if (arg == "--policy" && i + 1 < argc) {
+            policy_name = argv[++i];
+        }
+        else if (arg == "--no-lockstep") {
+            lockstep = false;
+        }
+        else if (arg == "--convert" && i + 1 < argc) {
+            convert_path = argv[++i];
+        }
+        else if (arg == "--binary-output" && i + 1 < argc) {
+            binary_output_path = argv[++i];
+        }
+        else if (arg == "--count" && i + 1 < argc) {
+            auto limit = parse_count(argv[++i], 1);
+            if (!limit) {
+                std::cerr << "--count expects a positive limit, got " << argv[i] << "\n";
+                return 2;
+            }
+            count_limit = *limit;
+        }
+        else if (arg == "--stats") {
+            show_stats = true;
+        }
+        else if (arg == "--serve") {
+            serve = true;
+        }
+        else if (arg == "--listen" && i + 1 < argc) {
+            listen_path = argv[++i];
+        }
+        else if (arg == "--box" && i + 1 < argc) {
+            box_shape = argv[++i];
+        }
+        else if (arg == "--variant" && i + 1 < argc) {
+            variant_names = argv[++i];
+        }
+        else if (arg == "--parallel-search") {
+            parallel_search = true;
+        }
+        else if (arg.starts_with('-') && arg != "-") {
+            std::cerr << "unknown argument " << arg << ", or it is missing its value\n";
+            return 2;
+        }
+        else if (has_path) {
+            std::cerr << "only one puzzle file can be given, got " << path << " and " << arg << "\n";
+            return 2;
+        }
+        else {
+            path = arg;
+            has_path = true;
+        }
+    }
+
+    if (!box_shape.empty()) {
+        auto solve_basic = find_basic_solver(box_shape);
+        if (!solve_basic) {
+            std::cerr << "unknown box shape " << box_shape << ", expected 2x2, 2x3, 3x3, 3x4, 4x4 or 5x5\n";
+            return 2;
+        }
+
+        std::ifstream file;
+        if (path != "-") {
+            file.open(std::string(path));
+            if (!file) {
+                std::cerr << "could not open " << path << "\n";
+                return 2;
+            }
+        }
+        try {
+            auto& is = path == "-" ? std::cin : file;
+            return solve_basic(is, std::cout, count_limit);
+        }
+        catch (const parse_error& e) {
+            std::cout.flush();
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+    }
+
+    if (show_stats && !stats::enabled) {
+        std::cerr << "built without SUDOKU_STATS, the counters stay zero\n";
+    }
+
+    std::unique_ptr<solver_engine> engine;
+    branch_policy policy;
+    try {
+        policy = parse_branch_policy(policy_name);
+        engine = make_engine(engine_name, policy);
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+
+    //parallel search branches like get_minimal_action outside any engine, so nothing else would take effect
+    if (parallel_search && (engine_name != "rules" || policy != branch_policy::mrv || show_stats)) {
+        std::cerr << "--parallel-search only runs the rules engine with the mrv policy, without --stats\n";
+        return 2;
+    }
+
+    if (serve || !listen_path.empty()) {
+        server_options options{ std::max(num_threads, 1u), engine_name, policy };
+        try {
+            if (!listen_path.empty()) {
+                serve_socket(std::string(listen_path), options);
+            }
+            else {
+                serve_stream(std::cin, std::cout, options);
+            }
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+        return 0;
+    }
+
+    //the counters only see what the engines do, the lockstep pass would go missing from them
+    const batch_options options{ num_threads, engine_name, policy, lockstep && !show_stats, show_stats };
+
+    if (!variant_names.empty()) {
+        variant_rules rules;
+        try {
+            rules = parse_variant_rules(variant_names);
+        }
+        catch (const std::invalid_argument& e) {
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+        if (engine_name != "rules") {
+            std::cerr << "--variant needs the rules engine, dlx only covers rows, columns and boxes\n";
+            return 2;
+        }
+
+        std::ifstream file;
+        if (path != "-") {
+            file.open(std::string(path));
+            if (!file) {
+                std::cerr << "could not open " << path << "\n";
+                return 2;
+            }
+        }
+        try {
+            return solve_variant_stream(path == "-" ? std::cin : file, std::cout, rules, count_limit, options);
+        }
+        catch (const parse_error& e) {
+            std::cout.flush();
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+    }
+
+    if (count_limit > 0) {
+        try {
+            if (path == "-") {
+                std::string text{ std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>() };
+                return count_puzzles(text, std::cout, count_limit, options);
+            }
+            mapped_file file{ std::string(path) };
+            return count_puzzles(file.text(), std::cout, count_limit, options);
+        }
+        catch (const std::runtime_error& e) {
+            std::cout.flush();
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+    }
+
+    const auto run = [&](std::istream& is) {
+        try {
+            if (parallel_search) {
+                task_pool pool(num_threads);
+                return solve_stream(is, std::cout, *engine, &pool, false);
+            }
+            if (num_threads == 1) {
+                return solve_stream(is, std::cout, *engine, nullptr, show_stats);
+            }
+
+            std::vector<sudoku> puzzles;
+            std::string line;
+            long long line_number = 0;
+            while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+                puzzles.push_back(parse_line(line, line_number));
+            }
+            return solve_parallel(puzzles, std::cout, options);
+        }
+        catch (const parse_error& e) {
+            std::cout.flush();
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+    };
+
+    if (path == "-") {
+        if (!convert_path.empty() || !binary_output_path.empty()) {
+            std::cerr << "--convert and --binary-output need a puzzle file\n";
+            return 2;
+        }
+        return run(std::cin);
+    }
+
+    if (parallel_search) {
+        std::ifstream is{ std::string(path) };
+        if (!is) {
+            std::cerr << "could not open " << path << "\n";
+            return 2;
+        }
+        return run(is);
+    }
+
+    try {
+        mapped_file file{ std::string(path) };
+        if (!convert_path.empty()) {
+            return convert_file(file, std::string(convert_path));
+        }
+
+        if (binary_output_path.empty()) {
+            return solve_file(file, std::cout, nullptr, options);
+        }
+
+        std::ofstream os{ std::string(binary_output_path), std::ios::binary };
+        if (!os) {
+            std::cerr << "could not open " << binary_output_path << "\n";
+            return 2;
+        }
+        puzzle_writer writer(os);
+        return solve_file(file, std::cout, &writer, options);
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+}
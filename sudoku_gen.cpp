@@ -0,0 +1,148 @@
+﻿// sudoku_gen.cpp : Generates graded puzzles with a unique solution, one per line.
+//
+// usage: sudoku_gen [-j threads] [--count n] [--difficulty easy|medium|hard|expert|evil] [--seed n]
+//                   [--no-symmetry] [--binary-output puzzle_file]
+//   writes --count puzzles (1000 by default) of the given difficulty (hard by default) to stdout as they
+//   are generated, with one worker per core by default. the same seed gives the same puzzles for any -j,
+//   see grade in puzzle_generator.h for what each difficulty means
+//   --no-symmetry lets the givens fall anywhere instead of keeping them symmetric under a half turn
+//   --binary-output writes the puzzles in the binary format instead of to stdout
+
+#include "sudoku.h"
+#include "puzzle_generator.h"
+#include "puzzle_format.h"
+#include "task_pool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+    constexpr std::string_view usage =
+        "usage: sudoku_gen [-j threads] [--count n] [--difficulty easy|medium|hard|expert|evil] [--seed n]\n"
+        "                  [--no-symmetry] [--binary-output puzzle_file]\n";
+
+    // a whole decimal number no smaller than min, nothing for anything else
+    template <typename T>
+    std::optional<T> parse_number(std::string_view arg, T min) {
+        T value{};
+        auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+        if (error != std::errc{} || end != arg.data() + arg.size() || value < min) {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::ios::sync_with_stdio(false);
+
+    unsigned num_threads = std::thread::hardware_concurrency();
+    int count = 1000;
+    std::string_view difficulty_name = "hard";
+    std::uint64_t seed = 1;
+    bool symmetric = true;
+    std::string_view binary_output_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            auto threads = parse_number(std::string_view(argv[++i]), 1);
+            if (!threads) {
+                std::cerr << "-j expects a positive number of threads, got " << argv[i] << "\n" << usage;
+                return 2;
+            }
+            num_threads = static_cast<unsigned> (*threads);
+        }
+        else if (arg == "--count" && i + 1 < argc) {
+            auto n = parse_number(std::string_view(argv[++i]), 1);
+            if (!n) {
+                std::cerr << "--count expects a positive number of puzzles, got " << argv[i] << "\n" << usage;
+                return 2;
+            }
+            count = *n;
+        }
+        else if (arg == "--difficulty" && i + 1 < argc) {
+            difficulty_name = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            auto n = parse_number(std::string_view(argv[++i]), std::uint64_t{ 0 });
+            if (!n) {
+                std::cerr << "--seed expects a whole number, got " << argv[i] << "\n" << usage;
+                return 2;
+            }
+            seed = *n;
+        }
+        else if (arg == "--no-symmetry") {
+            symmetric = false;
+        }
+        else if (arg == "--binary-output" && i + 1 < argc) {
+            binary_output_path = argv[++i];
+        }
+        else {
+            std::cerr << "unknown argument " << arg << "\n" << usage;
+            return 2;
+        }
+    }
+
+    try {
+        const difficulty target = parse_difficulty(difficulty_name);
+
+        std::ofstream binary_os;
+        std::optional<puzzle_writer> writer;
+        if (!binary_output_path.empty()) {
+            binary_os.open(std::string(binary_output_path), std::ios::binary);
+            if (!binary_os) {
+                std::cerr << "could not open " << binary_output_path << "\n";
+                return 2;
+            }
+            writer.emplace(binary_os);
+        }
+
+        long long total_clues = 0;
+        std::string out;
+        const auto emit = [&](std::span<const graded_puzzle> puzzles) {
+            out.clear();
+            for (const auto& p : puzzles) {
+                total_clues += p.clues;
+                if (writer) {
+                    writer->write(p.puzzle);
+                    continue;
+                }
+                out += to_string(p.puzzle);
+                out += '\n';
+            }
+            std::cout.write(out.data(), static_cast<std::streamsize> (out.size()));
+            std::cout.flush();
+        };
+
+        task_pool pool(std::max(num_threads, 1u));
+        auto result = generate_puzzles(count, target, seed, pool, emit, symmetric);
+        if (writer) {
+            writer->finish();
+        }
+
+        std::cerr << "generated " << result.num_puzzles << " " << to_string(target) << " sudokus in " << result.seconds
+                  << "s on " << pool.size() << " threads (" << result.puzzles_per_second() << " puzzles/s), "
+                  << (result.num_puzzles ? static_cast<double> (total_clues) / result.num_puzzles : 0.0) << " clues on average\n";
+        if (result.num_failed > 0) {
+            std::cerr << result.num_failed << " puzzles did not reach " << to_string(target) << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+}
@@ -6,10 +6,11 @@
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <variant>
 
-class sudoku;
+#include "sudoku.h"
 
 class sudoku_render {
 
@@ -22,72 +23,31 @@ public:
     void render(sf::RenderWindow& window, sudoku& s);
 };
 
-struct cell_action {
-    int cell_idx;
-};
-
-enum class unit {
-    row,
-    column,
-    box,
-};
-
-struct unit_action {
-    unit type;
-    int unit_idx;
-    int action;
-};
-
-struct contradiction {};
-
-class sudoku {
-
-    friend class sudoku_render;
-
-    std::array<int, 9 * 9> grid_{};
-    std::array<int, 9 * 9> annotations_{};
-
-private: 
-
-    void load_annotate();
-
-    auto annotation(auto fn) const;
-
-    int column_annotation(int col) const;
-    int row_annotation(int row) const;
-    int box_annotation(int box) const;
-
-    void solve_naked_singles();
-    void solve_hidden_singles();
-    void annotate_subsets();
-
-public:
-
-    sudoku(std::array<int, 9 * 9> grid);
-    sudoku(const sudoku& o) = default;
-
-    static std::variant<sudoku, contradiction> advance(const sudoku& s);
-    static int distance(const sudoku& s1, const sudoku& s2);
-    bool is_solved() const;
-
-    static bool validate(const sudoku& s);
-    static std::vector<cell_action> get_minimal_cell_actions(const sudoku& s, int branch_factor);
-    static std::vector<unit_action> get_minimal_unit_actions(const sudoku& s, int branch_factor);
-    static std::vector<std::variant<cell_action, unit_action>> get_minimal_actions(const sudoku& s, int branch_factor);
-    static std::vector<sudoku> branch(const sudoku& s, cell_action ca);
-    static std::vector<sudoku> branch(const sudoku& s, unit_action ca);
-};
-
 class application {
 
     sf::RenderWindow window_{ sf::VideoMode(800, 600), "sudoku_solver" };
     sudoku_render renderer;
-    std::vector<sudoku> sudoku_states_;
-    std::vector <std::pair<std::variant<cell_action, unit_action>, sudoku>> sudoku_search_stack_;
+    // the changes of every step since the puzzle was loaded, never unwound. a backtrack is a step of its own
+    // that logs the cells it restores, so any earlier state can be rebuilt by undoing from the current one
+    sudoku_trail trail_;
+    sudoku current_{ load_sudoku() };
+    std::vector<std::size_t> step_marks_{ 0 };
+
+    // the branched on states as marks on trail_, with the choices that were not tried yet
+    struct choice_point {
+        std::size_t mark;
+        std::variant<cell_action, unit_action> action;
+        std::uint16_t remaining;
+    };
+    std::vector<choice_point> choice_points_;
     int sudoku_puzzle_idx_{ -1 };
     int sudoku_state_display_idx_{ -1 };
 
 
+    void load(int puzzle_choice);
+    bool backtrack();
+    sudoku displayed_state() const;
+
     static void draw_gridlines(sf::RenderWindow& window);
     static void draw_thicklines(sf::RenderWindow& window);
 public:
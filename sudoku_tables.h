@@ -0,0 +1,78 @@
+﻿// sudoku_tables.h : Cell index tables for the units and peers of a grid, built at compile time for any box shape.
+// the 9x9 tables every solver uses are the ones of 3x3 boxes.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace sudoku_tables {
+
+    // cell index tables of a grid with boxes of BoxRows x BoxColumns cells, the grid is as wide as a box has cells
+    template <int BoxRows, int BoxColumns>
+    struct grid_tables {
+        static constexpr int digits = BoxRows * BoxColumns;
+        static constexpr int num_cells = digits * digits;
+        static constexpr int num_units = 3 * digits;
+        static constexpr int num_peers = 2 * (digits - 1) + (BoxRows - 1) * (BoxColumns - 1);
+
+        using index = std::conditional_t<num_cells <= 256, std::uint8_t, std::uint16_t>;
+        using unit_list = std::array<index, digits>;
+        using peer_list = std::array<index, num_peers>;
+
+        std::array<unit_list, num_units> units{};   //rows, then columns, then boxes, each in board order
+        std::array<peer_list, num_cells> peers{};   //in board order
+
+        static constexpr int box_of(int idx) {
+            return BoxRows * (idx / digits / BoxRows) + idx % digits / BoxColumns;
+        }
+
+        static constexpr grid_tables make() {
+            grid_tables t{};
+            std::array<int, num_units> fill{};
+            for (int idx = 0; idx < num_cells; ++idx) {
+                for (int u : { idx / digits, digits + idx % digits, 2 * digits + box_of(idx) }) {
+                    t.units[u][fill[u]++] = static_cast<index> (idx);
+                }
+
+                int p = 0;
+                for (int other = 0; other < num_cells; ++other) {
+                    if (other != idx && (other / digits == idx / digits || other % digits == idx % digits || box_of(other) == box_of(idx))) {
+                        t.peers[idx][p++] = static_cast<index> (other);
+                    }
+                }
+            }
+            return t;
+        }
+    };
+
+    template <int BoxRows, int BoxColumns>
+    inline constexpr auto tables_for = grid_tables<BoxRows, BoxColumns>::make();
+
+    using classic_grid = grid_tables<3, 3>;
+    using unit_list = classic_grid::unit_list;
+    using peer_list = classic_grid::peer_list;
+
+    inline constexpr const auto& classic = tables_for<3, 3>;
+
+    constexpr int box_of(int idx) {
+        return classic_grid::box_of(idx);
+    }
+}
+
+constexpr const sudoku_tables::unit_list& row(int n) {
+    return sudoku_tables::classic.units[n];
+}
+
+constexpr const sudoku_tables::unit_list& column(int n) {
+    return sudoku_tables::classic.units[9 + n];
+}
+
+constexpr const sudoku_tables::unit_list& box(int n) {
+    return sudoku_tables::classic.units[18 + n];
+}
+
+constexpr const sudoku_tables::peer_list& peers(int n) {
+    return sudoku_tables::classic.peers[n];
+}
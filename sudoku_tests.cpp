@@ -0,0 +1,475 @@
+// sudoku_tests.cpp : Regression tests for the solving paths that have to agree with each other.
+//
+// usage: sudoku_tests
+//   runs every test and prints the failing checks to stderr, exits with 1 when any of them failed
+
+#include "sudoku.h"
+#include "basic_sudoku.h"
+#include "batch_solver.h"
+#include "lockstep_solver.h"
+#include "puzzle_format.h"
+#include "solver_engine.h"
+#include "simd_kernels.h"
+#include "variant_sudoku.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+    int num_failed = 0;
+
+    void check(bool condition, const std::string& what) {
+        if (!condition) {
+            ++num_failed;
+            std::cerr << "failed: " << what << "\n";
+        }
+    }
+
+    // whether f throws an Error
+    template <typename Error, typename F>
+    bool throws(F f) {
+        try {
+            f();
+        }
+        catch (const Error&) {
+            return true;
+        }
+        return false;
+    }
+
+    // the curated puzzles with one open cell set to a digit no solution has there, one none of the givens rule out, so
+    // most of them only fail deep in the search. puzzles with several solutions can stay solvable
+    std::vector<sudoku> unsolvable_puzzles() {
+        std::vector<sudoku> puzzles;
+        for (int p = 0; p < num_curated_sudokus(); ++p) {
+            if (curated_difficulty(p) == difficulty::partial) {
+                continue;
+            }
+            const auto puzzle = load_sudoku(p);
+            const auto solution = solve(puzzle);
+
+            std::array<int, 9 * 9> grid;
+            std::copy(puzzle.grid().begin(), puzzle.grid().end(), grid.begin());
+            for (int i = 0; i < 81; ++i) {
+                if (grid[i] != 0) {
+                    continue;
+                }
+                for (int digit = 1; digit <= 9; ++digit) {
+                    grid[i] = digit;
+                    if (digit != solution.grid()[i] && sudoku::validate(sudoku(grid))) {
+                        break;
+                    }
+                    grid[i] = 0;
+                }
+                if (grid[i] != 0) {
+                    break;
+                }
+            }
+            puzzles.emplace_back(grid);
+        }
+        return puzzles;
+    }
+
+    void lockstep_keeps_unsolvable_puzzles() {
+        const auto puzzles = unsolvable_puzzles();
+        std::vector<sudoku> solutions(puzzles.size(), puzzles.front());
+        auto engine = make_engine("rules");
+
+        const int solved = solve_lockstep(puzzles, solutions, *engine);
+        int expected = 0;
+        for (std::size_t i = 0; i < puzzles.size(); ++i) {
+            const auto solution = solve(puzzles[i]);
+            expected += solution.is_solved();
+            check(to_string(solutions[i]) == to_string(solution), "lockstep and solve differ on " + to_string(puzzles[i]));
+        }
+        check(solved == expected, "lockstep solved " + std::to_string(solved) + " puzzles, solve " + std::to_string(expected));
+    }
+
+    // an unsolvable puzzle is written back as it was read, not as far as propagation got with it
+    void unsolvable_puzzles_come_back_unchanged() {
+        for (const auto& puzzle : unsolvable_puzzles()) {
+            const auto solution = solve(puzzle);
+            check(solution.is_solved() || to_string(solution) == to_string(puzzle), "solve changed " + to_string(puzzle));
+            for (auto name : engine_names()) {
+                const auto engine_solution = make_engine(name)->solve(puzzle);
+                check(engine_solution.is_solved() || to_string(engine_solution) == to_string(puzzle),
+                      std::string(name) + " changed " + to_string(puzzle));
+            }
+        }
+    }
+
+    // none, one and more solutions than the limit, which is where the count stops
+    void solutions_are_counted_up_to_the_limit() {
+        const auto puzzles = unsolvable_puzzles();
+        const auto unsolvable = *std::find_if(puzzles.begin(), puzzles.end(), [](const sudoku& s) { return !solve(s).is_solved(); });
+        const auto unique = load_sudoku(0);
+        int partial_choice = 0;
+        while (curated_difficulty(partial_choice) != difficulty::partial) {
+            ++partial_choice;
+        }
+        const auto partial = load_sudoku(partial_choice);
+
+        for (auto name : engine_names()) {
+            auto engine = make_engine(name);
+            const std::string label = std::string(name) + " counted ";
+            check(engine->count_solutions(unsolvable, 2) == 0, label + "solutions of an unsolvable puzzle");
+            check(engine->count_solutions(unique, 2) == 1 && engine->count_solutions(unique, 50) == 1, label + "a unique puzzle wrong");
+            for (int limit : { 1, 2, 50 }) {
+                const int count = engine->count_solutions(partial, limit);
+                check(count == limit, label + std::to_string(count) + " solutions of the partial puzzle with limit " + std::to_string(limit));
+            }
+        }
+        check(count_solutions(unsolvable) == 0 && count_solutions(unique) == 1 && count_solutions(partial) == 2, "count_solutions disagrees with the engines");
+
+        //what --count runs, a count equal to the limit stands for that many or more
+        const std::string text = to_string(unsolvable) + "\n" + to_string(unique) + "\n" + to_string(partial) + "\n";
+        task_pool pool(2);
+        std::vector<int> counts;
+        const auto result = count_text(text, pool, [&](std::span<const int> chunk) { counts.insert(counts.end(), chunk.begin(), chunk.end()); });
+        check(counts == std::vector<int>{ 0, 1, 2 }, "count_text counted differently");
+        check(result.num_puzzles == 3 && result.num_unique == 1 && result.num_unsolvable == 1, "count_text summed up differently");
+    }
+
+    // the search stops validating the grid once the givens are checked, so every placement has to keep it valid
+    void solutions_are_valid() {
+        auto puzzles = unsolvable_puzzles();
+        for (int p = 0; p < num_curated_sudokus(); ++p) {
+            puzzles.push_back(load_sudoku(p));
+        }
+        for (auto policy : { branch_policy::mrv, branch_policy::degree, branch_policy::prefer_unit, branch_policy::random }) {
+            auto engine = make_engine("rules", policy);
+            for (const auto& puzzle : puzzles) {
+                const auto solution = engine->solve(puzzle);
+                check(!solution.is_solved() || sudoku::validate(solution), "invalid solution " + to_string(solution));
+            }
+        }
+    }
+
+    // variant puzzles go through the same engine as plain ones, only their tables differ
+    void variant_rules_narrow_the_solutions() {
+        //two solutions as plain sudoku, one of them has distinct diagonals
+        const std::string puzzle = ".......4.4..7.6.581..9....6...2.4.1.8..5...........3..7.1..8.....64.37...2....6..";
+        const std::string expected = "965382147432716958187945236679234815813569472254871369741698523596423781328157694";
+        auto engine = make_engine("rules");
+
+        const variant_tables x_tables(parse_variant_rules("x"));
+        variant_rules rules;
+        const sudoku x_puzzle(parse_variant_puzzle(puzzle, rules), x_tables);
+        check(engine->count_solutions(parse_sudoku(puzzle), 2) == 2, "the plain puzzle lost a solution");
+        check(engine->count_solutions(x_puzzle, 2) == 1, "the x puzzle is not unique");
+        check(to_string(engine->solve(x_puzzle)) == expected, "the x puzzle solved to " + to_string(engine->solve(x_puzzle)));
+
+        //cages over pairs of cells adding up to the solution of a curated puzzle leave only that solution, one
+        //pair summing differently leaves none
+        const auto givens = load_sudoku(0);
+        const auto solution = solve(givens);
+        std::array<int, 9 * 9> grid;
+        std::copy(givens.grid().begin(), givens.grid().end(), grid.begin());
+        for (int miss = 0; miss < 2; ++miss) {
+            variant_rules killer;
+            for (int i = 0; i + 1 < 81; i += 2) {
+                const int a = solution.grid()[i];
+                const int b = solution.grid()[i + 1];
+                if (a != b) {
+                    killer.cages.push_back({ a + b + (miss && killer.cages.empty() ? (a + b < 17 ? 1 : -1) : 0), { i, i + 1 } });
+                }
+            }
+            const variant_tables killer_tables(killer);
+            const auto killer_solution = engine->solve(sudoku(grid, killer_tables));
+            check(killer_solution.is_solved() == !miss, "the killer puzzle is " + std::string(miss ? "" : "not ") + "solvable");
+            check(miss || to_string(killer_solution) == to_string(solution), "the killer puzzle solved to " + to_string(killer_solution));
+        }
+    }
+
+    // the exact cover search has to find what the rules engine finds, and only covers plain sudoku
+    void dlx_agrees_with_rules() {
+        auto puzzles = unsolvable_puzzles();
+        for (int p = 0; p < num_curated_sudokus(); ++p) {
+            //every given and then every other given, the second ones mostly with many solutions
+            const auto puzzle = load_sudoku(p);
+            std::array<int, 9 * 9> sparse{};
+            for (int i = 0, kept = 0; i < 81; ++i) {
+                if (puzzle.grid()[i] && kept++ % 2 == 0) {
+                    sparse[i] = puzzle.grid()[i];
+                }
+            }
+            puzzles.push_back(puzzle);
+            puzzles.emplace_back(sparse);
+        }
+
+        auto rules = make_engine("rules");
+        auto dlx = make_engine("dlx");
+        for (const auto& puzzle : puzzles) {
+            const int count = rules->count_solutions(puzzle, 10);
+            check(dlx->count_solutions(puzzle, 10) == count, "dlx counts differently on " + to_string(puzzle));
+
+            const auto solution = dlx->solve(puzzle);
+            check(solution.is_solved() == (count > 0) && (!solution.is_solved() || sudoku::validate(solution)), "dlx solved " + to_string(puzzle) + " wrong");
+            if (count == 1) {
+                check(to_string(solution) == to_string(rules->solve(puzzle)), "dlx found another solution of " + to_string(puzzle));
+            }
+        }
+
+        const variant_tables x_tables(parse_variant_rules("x"));
+        const sudoku x_puzzle({}, x_tables);
+        check(throws<std::invalid_argument>([&]() { dlx->solve(x_puzzle); }), "dlx solved a puzzle with variant rules");
+        check(throws<std::invalid_argument>([&]() { dlx->count_solutions(x_puzzle, 2); }), "dlx counted a puzzle with variant rules");
+    }
+
+    // every kernel has to give the same answer whichever instruction set runs it
+    void kernels_agree_with_scalar() {
+        const auto* scalar = kernels::find_kernels("scalar");
+        const auto* avx2 = kernels::find_kernels("avx2");
+        if (!avx2) {
+            std::cerr << "skipped kernels_agree_with_scalar, this cpu has no avx2\n";
+            return;
+        }
+
+        using grid_state = std::pair<std::array<std::uint8_t, 81>, std::array<std::uint16_t, 81>>;
+        std::vector<grid_state> states;
+        const auto add_state = [&](const sudoku& s, std::uint16_t open_annotation) {
+            grid_state state{ s.grid(), {} };
+            for (int i = 0; i < 81; ++i) {
+                state.second[i] = s.grid()[i] ? static_cast<std::uint16_t> (1 << (s.grid()[i] - 1)) : open_annotation;
+            }
+            states.push_back(state);
+        };
+
+        //empty, full, the curated puzzles and a full grid with a clash in its last cell
+        add_state(sudoku({}), 0b111111111);
+        const auto solution = solve(load_sudoku(0));
+        add_state(solution, 0);
+        for (int p = 0; p < num_curated_sudokus(); ++p) {
+            add_state(load_sudoku(p), 0b111111111);
+        }
+        auto clash = states[1];
+        clash.first[80] = clash.first[79];
+        states.push_back(clash);
+
+        //random grids, mostly invalid, with open cells of every candidate count including none
+        std::mt19937 rng(17);
+        for (int k = 0; k < 2000; ++k) {
+            grid_state state{};
+            for (int i = 0; i < 81; ++i) {
+                if (rng() % 3 == 0) {
+                    state.first[i] = static_cast<std::uint8_t> (1 + rng() % 9);
+                    state.second[i] = static_cast<std::uint16_t> (1 << (state.first[i] - 1));
+                }
+                else {
+                    state.second[i] = static_cast<std::uint16_t> (rng() & rng() & 0b111111111);
+                }
+            }
+            states.push_back(state);
+        }
+
+        for (const auto& [grid, annotations] : states) {
+            const auto a = avx2->min_candidate_cell(grid, annotations);
+            const auto s = scalar->min_candidate_cell(grid, annotations);
+            check(avx2->naked_singles(grid, annotations) == scalar->naked_singles(grid, annotations), "naked_singles kernels differ");
+            check(avx2->validate(grid) == scalar->validate(grid), "validate kernels differ");
+            check(a.cell_idx == s.cell_idx && a.count == s.count, "min_candidate_cell kernels differ");
+        }
+        check(scalar->validate(states[1].first) && !scalar->validate(clash.first), "validate misjudges a full grid");
+
+        //valid lines, and lines with a bad character anywhere including the last cell
+        std::vector<std::string> lines = { std::string(81, '.'), to_string(solution) };
+        const std::string alphabet = "0123456789. ";
+        for (int k = 0; k < 2000; ++k) {
+            std::string line(81, '.');
+            for (auto& c : line) {
+                c = alphabet[rng() % alphabet.size()];
+            }
+            if (k % 2) {
+                line[rng() % 81] = "x/:-\n"[rng() % 5];
+            }
+            lines.push_back(line);
+        }
+        lines.back()[80] = 'x';
+
+        for (const auto& line : lines) {
+            std::array<std::uint8_t, 81> a{};
+            std::array<std::uint8_t, 81> s{};
+            const int a_bad = avx2->parse_line(line.data(), a);
+            const int s_bad = scalar->parse_line(line.data(), s);
+            //the digits are only defined before the first bad character
+            const int parsed = s_bad < 0 ? 81 : s_bad;
+            check(a_bad == s_bad && std::equal(a.begin(), a.begin() + parsed, s.begin()), "parse_line kernels differ on " + line);
+        }
+    }
+
+    // records past several index strides, an empty and a full grid among them
+    void binary_files_round_trip() {
+        std::vector<sudoku> puzzles = { sudoku({}), solve(load_sudoku(0)) };
+        for (int k = 0; puzzles.size() < 2 * puzzle_format::index_stride + 100; ++k) {
+            puzzles.push_back(load_sudoku(k));
+        }
+
+        std::stringstream os(std::ios::in | std::ios::out | std::ios::binary);
+        puzzle_writer writer(os);
+        for (const auto& s : puzzles) {
+            writer.write(s);
+        }
+        writer.finish();
+        const std::string bytes = os.str();
+
+        puzzle_reader reader(bytes);
+        check(puzzle_format::is_binary(bytes) && reader.size() == puzzles.size(), "binary file holds " + std::to_string(reader.size()) + " records");
+        std::vector<sudoku> read(puzzles.size(), sudoku({}));
+        reader.read(0, read);
+        for (std::size_t i = 0; i < puzzles.size(); ++i) {
+            check(to_string(read[i]) == to_string(puzzles[i]), "record " + std::to_string(i) + " read back as " + to_string(read[i]));
+        }
+
+        //reads starting at and around the indexed records, some of them crossing one
+        const std::size_t stride = puzzle_format::index_stride;
+        for (std::size_t first : { std::size_t{ 0 }, stride - 1, stride, stride + 1, 2 * stride - 3, 2 * stride, puzzles.size() - 1 }) {
+            std::vector<sudoku> out(std::min<std::size_t>(5, puzzles.size() - first), sudoku({}));
+            reader.read(first, out);
+            for (std::size_t i = 0; i < out.size(); ++i) {
+                check(to_string(out[i]) == to_string(puzzles[first + i]), "record " + std::to_string(first + i) + " read from " + std::to_string(first));
+            }
+        }
+
+        //text to binary and back gives the same lines, comments dropped
+        std::string text = "# puzzles\n";
+        for (std::size_t i = 0; i < 50; ++i) {
+            text += to_string(puzzles[i]) + "\n";
+        }
+        std::stringstream binary(std::ios::in | std::ios::out | std::ios::binary);
+        check(text_to_binary(text, binary) == 50, "text_to_binary did not convert 50 puzzles");
+        std::ostringstream back;
+        check(binary_to_text(binary.str(), back) == 50, "binary_to_text did not convert 50 puzzles");
+        check(back.str() == text.substr(text.find('\n') + 1), "text came back from binary differently");
+    }
+
+    void damaged_binary_files_are_rejected() {
+        std::stringstream os(std::ios::in | std::ios::out | std::ios::binary);
+        puzzle_writer writer(os);
+        for (int p = 0; p < 10; ++p) {
+            writer.write(load_sudoku(p));
+        }
+        writer.finish();
+        const std::string bytes = os.str();
+
+        const auto read_all = [](const std::string& b) {
+            puzzle_reader reader(b);
+            std::vector<sudoku> out(reader.size(), sudoku({}));
+            reader.read(0, out);
+        };
+        const auto patched = [&](std::size_t pos, char c) {
+            std::string b = bytes;
+            b[pos] = c;
+            return b;
+        };
+
+        check(!throws<std::runtime_error>([&]() { read_all(bytes); }), "the intact file was rejected");
+        check(throws<std::runtime_error>([&]() { read_all(patched(0, 'X')); }), "a bad magic was accepted");
+        check(throws<std::runtime_error>([&]() { read_all(patched(4, 2)); }), "an unknown version was accepted");
+        check(throws<std::runtime_error>([&]() { read_all(bytes.substr(0, bytes.size() - 1)); }), "a truncated index was accepted");
+        check(throws<std::runtime_error>([&]() { read_all(bytes.substr(0, 20)); }), "a truncated header was accepted");
+        check(throws<std::runtime_error>([&]() { read_all(patched(8, 11)); }), "one record too many was accepted");
+        check(throws<std::runtime_error>([&]() { read_all(patched(15, 1)); }), "a huge record count was accepted");
+        //the first digit of the first record, right after its 11 byte occupancy mask
+        check(throws<std::runtime_error>([&]() { read_all(patched(puzzle_format::header_size + 11, 0)); }), "a zero digit was accepted");
+    }
+
+    // a grid of another box shape with most of a pattern solution cleared, solved and checked unit by unit
+    template <int BoxRows, int BoxColumns>
+    void basic_grid_solves() {
+        using grid_type = basic_sudoku<BoxRows, BoxColumns>;
+        constexpr int digits = grid_type::digits;
+        const std::string shape = std::to_string(BoxRows) + "x" + std::to_string(BoxColumns);
+
+        //shifting every row by a box width, and every band by one more, never repeats a digit in a unit
+        std::array<int, grid_type::num_cells> full{};
+        for (int r = 0; r < digits; ++r) {
+            for (int c = 0; c < digits; ++c) {
+                full[digits * r + c] = (BoxColumns * (r % BoxRows) + r / BoxRows + c) % digits + 1;
+            }
+        }
+        std::mt19937 rng(digits);
+        auto givens = full;
+        for (auto& d : givens) {
+            if (rng() % 5 < 3) {
+                d = 0;
+            }
+        }
+
+        const auto puzzle = parse_basic_sudoku<BoxRows, BoxColumns>(to_string(grid_type{ givens }));
+        basic_solver<BoxRows, BoxColumns> solver;
+        const auto solution = solver.solve(puzzle);
+        check(solution.is_solved(), shape + " puzzle was not solved");
+
+        bool valid = true;
+        for (int i = 0; i < grid_type::num_cells; ++i) {
+            valid = valid && (givens[i] == 0 || solution.grid()[i] == givens[i]);
+        }
+        for (const auto& unit : sudoku_tables::tables_for<BoxRows, BoxColumns>.units) {
+            std::uint64_t seen = 0;
+            for (int idx : unit) {
+                seen |= std::uint64_t{ 1 } << solution.grid()[idx];
+            }
+            valid = valid && seen == (std::uint64_t{ 1 } << (digits + 1)) - 2;
+        }
+        check(valid, shape + " solution breaks a unit or a given: " + to_string(solution));
+        check(solver.count_solutions(grid_type{ full }) == 1, shape + " full grid does not count as one solution");
+
+        //the same digit twice in the first row
+        auto clash = givens;
+        clash[0] = clash[1] = 1;
+        check(!solver.solve(grid_type{ clash }).is_solved(), shape + " puzzle with clashing givens was solved");
+    }
+
+    void crlf_lines_read_like_lf_lines() {
+        const std::string puzzle = to_string(load_sudoku(0));
+        const std::string text = "# comment\r\n\r\n" + puzzle + "\r\n" + puzzle + "\r\n# last\r\n" + puzzle;
+
+        std::istringstream is(text);
+        std::string line;
+        long long line_number = 0;
+        std::vector<long long> line_numbers;
+        while (puzzle_format::next_puzzle_line(is, line, line_number)) {
+            check(line == puzzle, "stream line read as '" + line + "'");
+            check(to_string(parse_sudoku(line)) == puzzle, "stream line parsed differently");
+            line_numbers.push_back(line_number);
+        }
+        check(line_numbers == std::vector<long long>{ 3, 4, 6 }, "stream lines found at the wrong line numbers");
+
+        std::size_t pos = 0;
+        int num_lines = 0;
+        for (auto view = puzzle_format::next_puzzle_line(text, pos); !view.empty(); view = puzzle_format::next_puzzle_line(text, pos)) {
+            check(view == puzzle, "text line read as '" + std::string(view) + "'");
+            ++num_lines;
+        }
+        check(num_lines == 3, "text has " + std::to_string(num_lines) + " puzzle lines");
+    }
+}
+
+int main() {
+    lockstep_keeps_unsolvable_puzzles();
+    unsolvable_puzzles_come_back_unchanged();
+    solutions_are_valid();
+    solutions_are_counted_up_to_the_limit();
+    variant_rules_narrow_the_solutions();
+    dlx_agrees_with_rules();
+    kernels_agree_with_scalar();
+    basic_grid_solves<2, 3>();
+    basic_grid_solves<4, 4>();
+    crlf_lines_read_like_lf_lines();
+    binary_files_round_trip();
+    damaged_binary_files_are_rejected();
+
+    if (num_failed > 0) {
+        std::cerr << num_failed << " checks failed\n";
+        return 1;
+    }
+    std::cerr << "all checks passed\n";
+    return 0;
+}
@@ -0,0 +1,133 @@
+﻿// task_pool.cpp : Work stealing thread pool.
+//
+
+#include "task_pool.h"
+
+#include <algorithm>
+
+namespace {
+    thread_local const task_pool* current_pool = nullptr;
+    thread_local unsigned current_worker = 0;
+}
+
+task_pool::task_pool(unsigned num_threads) {
+    num_threads = std::max(num_threads, 1u);
+
+    queues_.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+        queues_.push_back(std::make_unique<worker_queue>());
+    }
+
+    threads_.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+        threads_.emplace_back([this, i]() { run_worker(i); });
+    }
+}
+
+task_pool::~task_pool() {
+    wait();
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+unsigned task_pool::worker_index() {
+    return current_worker;
+}
+
+void task_pool::submit(std::function<void()> task) {
+    unsigned idx = current_pool == this ? current_worker : next_queue_++ % queues_.size();
+
+    ++pending_;
+    {
+        std::lock_guard lock(queues_[idx]->mutex);
+        queues_[idx]->tasks.push_back(std::move(task));
+    }
+    {
+        //taking the lock prevents a worker from missing the wakeup between its check and its wait
+        std::lock_guard lock(sleep_mutex_);
+        ++queued_;
+    }
+    sleep_cv_.notify_one();
+}
+
+void task_pool::wait() {
+    std::unique_lock lock(done_mutex_);
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+bool task_pool::try_pop(unsigned idx, std::function<void()>& task) {
+    // own work is taken LIFO, it is the most recently split and still warm in cache
+    std::lock_guard lock(queues_[idx]->mutex);
+    if (queues_[idx]->tasks.empty()) {
+        return false;
+    }
+    task = std::move(queues_[idx]->tasks.back());
+    queues_[idx]->tasks.pop_back();
+    return true;
+}
+
+bool task_pool::try_steal(unsigned idx, std::function<void()>& task) {
+    // stolen work is taken FIFO, the oldest entries are the largest ranges
+    for (unsigned offset = 1; offset < queues_.size(); ++offset) {
+        auto& victim = *queues_[(idx + offset) % queues_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void task_pool::finish_task() {
+    if (--pending_ == 0) {
+        std::lock_guard lock(done_mutex_);
+        done_cv_.notify_all();
+    }
+}
+
+void task_pool::run_worker(unsigned idx) {
+    current_pool = this;
+    current_worker = idx;
+
+    std::function<void()> task;
+    while (true) {
+        if (try_pop(idx, task) || try_steal(idx, task)) {
+            --queued_;
+            task();
+            task = nullptr;
+            finish_task();
+            continue;
+        }
+
+        std::unique_lock lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() { return queued_ > 0 || stop_; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+void task_pool::parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& fn) {
+    grain = std::max(grain, 1);
+
+    std::function<void(int, int)> split = [&](int b, int e) {
+        while (e - b > grain) {
+            int mid = b + (e - b) / 2;
+            submit([&split, mid, e]() { split(mid, e); });
+            e = mid;
+        }
+        fn(b, e);
+    };
+
+    submit([&split, begin, end]() { split(begin, end); });
+    wait();
+}
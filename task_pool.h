@@ -0,0 +1,62 @@
+﻿// task_pool.h : Work stealing thread pool used to spread independent solves across cores.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class task_pool {
+
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::atomic<int> queued_{ 0 };   //tasks sitting in a queue
+    std::atomic<int> pending_{ 0 };  //tasks submitted but not finished
+    std::atomic<unsigned> next_queue_{ 0 };
+    bool stop_{ false };
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+
+private:
+
+    bool try_pop(unsigned idx, std::function<void()>& task);
+    bool try_steal(unsigned idx, std::function<void()>& task);
+    void run_worker(unsigned idx);
+    void finish_task();
+
+public:
+
+    explicit task_pool(unsigned num_threads = std::thread::hardware_concurrency());
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+    ~task_pool();
+
+    unsigned size() const { return static_cast<unsigned> (threads_.size()); }
+
+    // index in [0, size()) of the worker running the calling task, for per-worker scratch state
+    static unsigned worker_index();
+
+    // tasks submitted from a worker go to the back of its own queue, other threads distribute round robin.
+    // a worker pops its own queue from the back, newest first, and steals from the front of the others
+    void submit(std::function<void()> task);
+
+    // blocks until every submitted task has finished, must not be called from a worker
+    void wait();
+
+    // runs fn(i) for i in [begin, end), ranges are split in halves so idle workers can steal the larger pieces
+    void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& fn);
+};
@@ -0,0 +1,205 @@
+﻿// variant_sudoku.cpp : Unit and peer tables for the rules of variant sudoku.
+//
+
+#include "variant_sudoku.h"
+#include "sudoku_tables.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+    constexpr std::uint16_t all_digits = 0b111111111;
+
+    constexpr int digit_sum(unsigned digits) {
+        int sum = 0;
+        for (; digits; digits &= digits - 1) {
+            sum += std::countr_zero(digits) + 1;
+        }
+        return sum;
+    }
+}
+
+variant_tables::variant_tables(const variant_rules& rules)
+    : classic_(!rules.diagonals && !rules.disjoint_groups && !rules.anti_knight && rules.cages.empty()) {
+    const auto add_unit = [&](unit type, const auto& cells, int sum) {
+        unit_cells u{ type, static_cast<int> (cells.size()), {}, {} };
+        std::copy(cells.begin(), cells.end(), u.cells.begin());
+
+        //units without a sum only need distinct digits, and 9 cells hold every digit whatever the sum says
+        if (sum != 0) {
+            for (unsigned digits = 1; digits <= all_digits; ++digits) {
+                if (std::popcount(digits) == u.size && digit_sum(digits) == sum) {
+                    u.combos.push_back(static_cast<std::uint16_t> (digits));
+                }
+            }
+            if (u.combos.empty()) {
+                throw std::invalid_argument("no " + std::to_string(u.size) + " distinct digits add up to " + std::to_string(sum));
+            }
+            if (u.size == 9) {
+                u.combos.clear();
+            }
+            else {
+                summed_units_.push_back(static_cast<int> (units_.size()));
+            }
+        }
+        units_.push_back(std::move(u));
+    };
+
+    //the order every search of plain sudoku has always walked them in
+    for (int n = 0; n < 9; ++n) {
+        add_unit(unit::column, column(n), 0);
+    }
+    for (int n = 0; n < 9; ++n) {
+        add_unit(unit::row, row(n), 0);
+    }
+    for (int n = 0; n < 9; ++n) {
+        add_unit(unit::box, box(n), 0);
+    }
+
+    if (rules.diagonals) {
+        std::array<std::uint8_t, 9> main{};
+        std::array<std::uint8_t, 9> anti{};
+        for (int i = 0; i < 9; ++i) {
+            main[i] = static_cast<std::uint8_t> (10 * i);
+            anti[i] = static_cast<std::uint8_t> (8 * (i + 1));
+        }
+        add_unit(unit::diagonal, main, 0);
+        add_unit(unit::diagonal, anti, 0);
+    }
+
+    if (rules.disjoint_groups) {
+        for (int n = 0; n < 9; ++n) {
+            std::array<std::uint8_t, 9> group{};
+            for (int b = 0; b < 9; ++b) {
+                group[b] = box(b)[n];
+            }
+            add_unit(unit::disjoint_group, group, 0);
+        }
+    }
+
+    for (const auto& cage : rules.cages) {
+        if (cage.cells.empty() || cage.cells.size() > 9) {
+            throw std::invalid_argument("a cage needs 1 to 9 cells, got " + std::to_string(cage.cells.size()));
+        }
+        std::vector<std::uint8_t> cells;
+        for (int idx : cage.cells) {
+            if (idx < 0 || idx >= 81 || std::find(cells.begin(), cells.end(), idx) != cells.end()) {
+                throw std::invalid_argument("bad cage cell " + std::to_string(idx));
+            }
+            cells.push_back(static_cast<std::uint8_t> (idx));
+        }
+        add_unit(unit::cage, cells, cage.sum);
+    }
+
+    //cells sharing a unit are peers, and so are cells a knight's move apart under anti-knight
+    std::array<std::array<bool, 81>, 81> linked{};
+    for (const auto& u : units_) {
+        for (int i = 0; i < u.size; ++i) {
+            for (int j = 0; j < u.size; ++j) {
+                linked[u.cells[i]][u.cells[j]] = true;
+            }
+        }
+    }
+
+    if (rules.anti_knight) {
+        constexpr std::array<std::array<int, 2>, 8> moves = { {
+            { -2, -1 }, { -2, 1 }, { -1, -2 }, { -1, 2 }, { 1, -2 }, { 1, 2 }, { 2, -1 }, { 2, 1 }
+        } };
+        for (int idx = 0; idx < 81; ++idx) {
+            for (const auto& [dr, dc] : moves) {
+                int r = idx / 9 + dr;
+                int c = idx % 9 + dc;
+                if (r >= 0 && r < 9 && c >= 0 && c < 9) {
+                    linked[idx][9 * r + c] = true;
+                }
+            }
+        }
+    }
+
+    for (int idx = 0; idx < 81; ++idx) {
+        for (int other = 0; other < 81; ++other) {
+            if (other != idx && linked[idx][other]) {
+                peers_[idx][num_peers_[idx]++] = static_cast<std::uint8_t> (other);
+            }
+        }
+    }
+}
+
+const variant_tables& classic_tables() {
+    static const variant_tables tables{ variant_rules{} };
+    return tables;
+}
+
+variant_rules parse_variant_rules(std::string_view names) {
+    variant_rules rules;
+    while (!names.empty()) {
+        const auto comma = names.find(',');
+        const auto name = names.substr(0, comma);
+        names = comma == std::string_view::npos ? std::string_view{} : names.substr(comma + 1);
+
+        if (name == "x") {
+            rules.diagonals = true;
+        }
+        else if (name == "disjoint") {
+            rules.disjoint_groups = true;
+        }
+        else if (name == "anti-knight") {
+            rules.anti_knight = true;
+        }
+        else if (name == "killer") {
+            continue;
+        }
+        else {
+            throw std::invalid_argument("unknown variant: " + std::string(name));
+        }
+    }
+    return rules;
+}
+
+std::array<int, 9 * 9> parse_variant_puzzle(std::string_view line, variant_rules& rules) {
+    const auto grid = parse_sudoku(line.substr(0, 81)).grid();
+
+    //every cage is a number, ':' and a comma separated list of numbers
+    std::size_t pos = 81;
+    const auto number = [&]() {
+        const std::size_t start = pos;
+        int n = 0;
+        while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9' && pos - start < 3) {
+            n = 10 * n + (line[pos++] - '0');
+        }
+        if (pos == start) {
+            throw parse_error(pos < line.size() ? "unexpected character '" + std::string(1, line[pos]) + "' at column " + std::to_string(pos + 1)
+                                                : "line ends in the middle of a cage", pos);
+        }
+        return n;
+    };
+    const auto expect = [&](char c) {
+        if (pos >= line.size() || line[pos] != c) {
+            throw parse_error(std::string("expected '") + c + "' at column " + std::to_string(pos + 1), pos);
+        }
+        ++pos;
+    };
+
+    while (pos < line.size()) {
+        if (line[pos] == ' ' || line[pos] == '\t') {
+            ++pos;
+            continue;
+        }
+
+        killer_cage cage{ number(), {} };
+        expect(':');
+        cage.cells.push_back(number());
+        while (pos < line.size() && line[pos] == ',') {
+            ++pos;
+            cage.cells.push_back(number());
+        }
+        rules.cages.push_back(std::move(cage));
+    }
+
+    std::array<int, 9 * 9> digits;
+    std::copy(grid.begin(), grid.end(), digits.begin());
+    return digits;
+}
@@ -0,0 +1,70 @@
+﻿// variant_sudoku.h : 9x9 sudoku with constraints on top of rows, columns and boxes: the diagonals of X-sudoku,
+// disjoint groups, killer cages and anti-knight. the rules are compiled into one unit and peer table that a sudoku
+// is built with, propagation and branching only ever walk that table so every variant goes through the same code.
+
+#pragma once
+
+#include "sudoku.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// cells are indexed in board order, 0 to 80. a sum of 0 leaves the cage unsummed, its digits still differ
+struct killer_cage {
+    int sum;
+    std::vector<int> cells;
+};
+
+struct variant_rules {
+    bool diagonals{ false };        //both long diagonals hold every digit once
+    bool disjoint_groups{ false };  //so do the cells at the same position in every box
+    bool anti_knight{ false };      //cells a knight's move apart never hold the same digit
+    std::vector<killer_cage> cages;
+};
+
+// the units and peers of one rule set, built once and shared by every state searched under it. the first 27 units
+// are the columns, rows and boxes in that order, the units of the rules follow.
+// throws std::invalid_argument for cages that are empty, larger than 9 cells, repeat a cell or cannot reach their sum
+class variant_tables {
+public:
+
+    struct unit_cells {
+        unit type;
+        int size;
+        std::array<std::uint8_t, 9> cells;
+        std::vector<std::uint16_t> combos;  //the digit sets a summed cage smaller than 9 cells can hold, 9 bit masks
+    };
+
+private:
+
+    std::vector<unit_cells> units_;
+    std::vector<int> summed_units_;
+    std::array<std::uint8_t, 81> num_peers_{};
+    std::array<std::array<std::uint8_t, 80>, 81> peers_{};
+    bool classic_;
+
+public:
+
+    explicit variant_tables(const variant_rules& rules);
+
+    const std::vector<unit_cells>& units() const { return units_; }
+
+    // the units with combos, in order
+    std::span<const int> summed_units() const { return summed_units_; }
+
+    std::span<const std::uint8_t> peers(int idx) const { return { peers_[idx].data(), num_peers_[idx] }; }
+
+    // whether the rules add nothing to rows, columns and boxes
+    bool classic() const { return classic_; }
+};
+
+// "x", "disjoint", "anti-knight", "killer" or a comma separated list of them, throws std::invalid_argument for
+// anything else. killer sets nothing, the cages come with each puzzle line
+variant_rules parse_variant_rules(std::string_view names);
+
+// 81 cells like parse_sudoku, then any number of killer cages separated by spaces, each a sum, ':' and its
+// comma separated cells ("10:0,1,9"). the cages are added to rules, throws parse_error for anything malformed
+std::array<int, 9 * 9> parse_variant_puzzle(std::string_view line, variant_rules& rules);